@@ -6,6 +6,7 @@
 #include <SFML/Graphics/RenderWindow.hpp>
 #include <json/value.h>
 #include <thread>
+#include <atomic>
 
 namespace QuickMedia {
     class Program;
@@ -59,6 +60,8 @@ namespace QuickMedia {
         void clamp_selection();
         void draw(sf::RenderWindow &window, sf::Vector2f pos, sf::Vector2f size);
         void draw(sf::RenderWindow &window, sf::Vector2f pos, sf::Vector2f size, const Json::Value &content_progress);
+        // @download_progress has the download progress of items by title: { "state": "queued"|"downloading"|"finished"|"failed", "downloaded": int, "total": int }
+        void draw(sf::RenderWindow &window, sf::Vector2f pos, sf::Vector2f size, const Json::Value &content_progress, const Json::Value &download_progress);
         static bool string_find_case_insensitive(const std::string &str, const std::string &substr);
 
         // TODO: Make this actually fuzzy... Right now it's just a case insensitive string find.
@@ -66,6 +69,12 @@ namespace QuickMedia {
         // TODO: Ignore dot, whitespace and special characters
         void filter_search_fuzzy(const std::string &text);
 
+        // Thumbnails are loaded one at a time in the background, the next one is started when the body is drawn.
+        // The body has to be drawn again when a thumbnail has finished loading, see |has_new_thumbnail|. The main thread is woken up when that happens
+        bool is_loading_thumbnail() const { return loading_thumbnail; }
+        // Returns true if a thumbnail has finished loading since the body was drawn
+        bool has_new_thumbnail() const { return new_thumbnail; }
+
         sf::Text title_text;
         sf::Text progress_text;
         sf::Text author_text;
@@ -82,6 +91,7 @@ namespace QuickMedia {
         Program *program;
         std::shared_ptr<sf::Texture> load_thumbnail_from_url(const std::string &url);
         std::unordered_map<std::string, ThumbnailData> item_thumbnail_textures;
-        bool loading_thumbnail;
+        std::atomic<bool> loading_thumbnail;
+        std::atomic<bool> new_thumbnail;
     };
 }
\ No newline at end of file
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "Path.hpp"
+#include <string>
+#include <unordered_map>
+#include <memory>
+#include <mutex>
+#include <stdint.h>
+
+namespace QuickMedia {
+    // A read-only mapping of the data file of a pack
+    class PackMapping {
+    public:
+        PackMapping(const char *data, size_t size) : data(data), size(size) {}
+        ~PackMapping();
+        PackMapping(const PackMapping&) = delete;
+        PackMapping& operator=(const PackMapping&) = delete;
+
+        const char *data;
+        size_t size;
+    };
+
+    struct PackedPage {
+        // Keeps |data| mapped
+        std::shared_ptr<PackMapping> mapping;
+        const char *data = nullptr;
+        size_t size = 0;
+    };
+
+    // The downloaded pages of a chapter, stored in one append-only data file (pages.data) and an index of where each page is in it (pages.index)
+    // instead of a file for each page. A page is added by appending it to the data file and then appending its location to the index,
+    // so a page that is in the index is complete. Pages are read from the data file through mmap, without copying them.
+    // Can be used from multiple threads, and multiple instances for the same chapter (in other threads or processes) can be used at the same time
+    class ChapterPack {
+    public:
+        ChapterPack(const Path &chapter_cache_dir);
+        ChapterPack(const ChapterPack&) = delete;
+        ChapterPack& operator=(const ChapterPack&) = delete;
+
+        bool has_page(int page_index);
+        // Returns false if the page is not in the pack
+        bool get_page(int page_index, PackedPage &page);
+        // Returns false if the page could not be written
+        bool add_page(int page_index, const std::string &data);
+        // A pack is complete when all pages of the chapter have been added, so the chapter doesn't have to be downloaded again
+        bool is_complete() const;
+        // Returns false if the pack could not be marked as complete
+        bool set_complete();
+        // Writes the pages that are in the pack to a cbz (uncompressed zip) file, so the chapter can be read by other readers.
+        // Returns the number of pages that were exported, or -1 on failure
+        int export_cbz(const Path &cbz_path);
+    private:
+        struct IndexEntry {
+            uint32_t page_index;
+            uint32_t reserved;
+            uint64_t offset;
+            uint64_t size;
+        };
+
+        // Reads the entries that have been added to the index since it was read last
+        void read_new_index_entries();
+        bool get_page_locked(int page_index, PackedPage &page);
+    private:
+        Path data_path;
+        Path index_path;
+        Path complete_path;
+        std::mutex mutex;
+        std::unordered_map<int, IndexEntry> index;
+        long index_read_size;
+        std::shared_ptr<PackMapping> mapping;
+    };
+}
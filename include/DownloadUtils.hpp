@@ -1,7 +1,9 @@
 #pragma once
 
+#include "Path.hpp"
 #include <string>
 #include <vector>
+#include <functional>
 
 namespace QuickMedia {
     enum class DownloadResult {
@@ -20,6 +22,20 @@ namespace QuickMedia {
         std::string value;
     };
 
-    DownloadResult download_to_string(const std::string &url, std::string &result, const std::vector<CommandArg> &additional_args, bool use_tor);
+    // Called after more data has been written to the file, with the size of the file, and every few hundred milliseconds while no data is received.
+    // Return false to cancel the download
+    using DownloadProgressCallback = std::function<bool(size_t downloaded_size)>;
+
+    // @progress_callback can be nullptr. It's called with the size of @result, and the download fails with DownloadResult::NET_ERR if it cancels the download
+    DownloadResult download_to_string(const std::string &url, std::string &result, const std::vector<CommandArg> &additional_args, bool use_tor, DownloadProgressCallback progress_callback = nullptr);
+    // The data is written to @path.part as it's downloaded, so the file can be read before the download has finished. The part file is renamed to @path
+    // when the download has finished and the size of the file is the size that the server said it is.
+    // If the part file exists, the download is resumed from the end of it with a range request. The part file is kept if the download fails.
+    // @progress_callback can be nullptr. Returns DownloadResult::ERR if the file can't be written to
+    DownloadResult download_to_file(const std::string &url, const Path &path, DownloadProgressCallback progress_callback, const std::vector<CommandArg> &additional_args, bool use_tor);
+    // |download_to_file| from the first of @urls, which are the same file on different mirrors. The urls on the hosts that have been the fastest
+    // are tried first (see |host_stats_sort_urls|). If the download fails or stalls, it's started over from the next mirror.
+    // The part file is only resumed from the host it was downloaded from, which is kept in @path.part.host
+    DownloadResult download_to_file_from_mirrors(std::vector<std::string> urls, const Path &path, DownloadProgressCallback progress_callback, const std::vector<CommandArg> &additional_args, bool use_tor);
     std::vector<CommandArg> create_command_args_from_form_data(const std::vector<FormData> &form_data);
 }
\ No newline at end of file
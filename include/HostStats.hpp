@@ -0,0 +1,18 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <stddef.h>
+
+namespace QuickMedia {
+    // Returns the host (and port) of @url, or an empty string if @url has no host
+    std::string get_url_host(const std::string &url);
+
+    // Records a download from @host, so the fastest host can be used for later downloads. @latency_ms is the time until the response
+    // headers were received, or a negative value if they were not. @stalled is true if the download was stopped because it was too slow.
+    // Can be called from any thread
+    void host_stats_record_download(const std::string &host, bool succeeded, bool stalled, double latency_ms, size_t downloaded_size, double transfer_ms);
+    // Sorts @urls so the urls on the hosts that have been the fastest are first. Urls on hosts that have not been used yet keep their order.
+    // Can be called from any thread
+    void host_stats_sort_urls(std::vector<std::string> &urls);
+}
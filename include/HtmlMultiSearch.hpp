@@ -0,0 +1,71 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <functional>
+#include <stdint.h>
+
+namespace QuickMedia {
+    class HtmlNode {
+    public:
+        // Returns nullptr if the node doesn't have the attribute
+        const char* get_attribute_value(const char *name) const;
+        // Returns the text of the first child of the node, or an empty string if the first child is not text
+        std::string get_text() const;
+    private:
+        friend class HtmlMultiSearch;
+        const void *doc;
+        const void *node;
+    };
+
+    using HtmlNodeCallback = std::function<void(const HtmlNode &node)>;
+    using HtmlItemEndCallback = std::function<void()>;
+
+    // Finds the nodes of several queries with a single traversal of the document.
+    // A query is a subset of xpath: steps separated by / (child) or // (descendant), where each step is a tag name or *
+    // with an optional attribute predicate, [name='value'] or [name]. The class attribute matches if one of its classes is @value,
+    // other attributes have to be equal to @value.
+    class HtmlMultiSearch {
+    public:
+        // Returns false if @xpath is not a valid query
+        bool add_query(const std::string &xpath, HtmlNodeCallback callback);
+        // Each node that matches @xpath is an item. @begin_callback is called when the item node is found, then the callbacks of the
+        // child queries of the item for the nodes inside the item node, and then @end_callback.
+        // Nodes that match @xpath inside an item node are part of the outer item, they are not items of their own.
+        // Returns the index of the item query, or -1 if @xpath is not a valid query
+        int add_item_query(const std::string &xpath, HtmlNodeCallback begin_callback, HtmlItemEndCallback end_callback);
+        // @xpath is relative to the item node, for example //a matches all links inside the item.
+        // Returns false if @xpath is not a valid query
+        bool add_item_child_query(int item_query, const std::string &xpath, HtmlNodeCallback callback);
+
+        // Returns 0 on success
+        int run(const char *html_source);
+    private:
+        struct Step {
+            std::string tag_name; // Empty for *
+            std::string attribute_name;
+            std::string attribute_value;
+            bool has_attribute_value = false;
+        };
+
+        struct Query {
+            std::vector<Step> steps;
+            uint64_t descendant_steps_mask = 0; // Bit n is set if step n can match any descendant instead of only a child
+            HtmlNodeCallback callback;
+            HtmlItemEndCallback end_callback;
+            int item_query = -1; // Index of the item query this is a child query of
+            bool is_item = false;
+        };
+
+        bool parse_xpath(const std::string &xpath, Query &query);
+        static bool step_matches(const Step &step, const void *node);
+        void traverse(const void *node, size_t depth);
+    private:
+        std::vector<Query> queries;
+        // States of all queries for each depth of the traversal. Bit n of a query state is set if step n can match the next node
+        std::vector<uint64_t> states;
+        // Bit n is set while the traversal is inside a node of item query n
+        uint64_t open_items = 0;
+        const void *doc = nullptr;
+    };
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <SFML/Graphics/Image.hpp>
+#include <stddef.h>
+
+namespace QuickMedia {
+    // Returns the scale (at most 1) that makes @size fit in @max_size while keeping the aspect ratio.
+    // A component of @max_size that is 0 doesn't limit the size
+    float get_image_fit_scale(sf::Vector2u size, sf::Vector2u max_size);
+
+    // Decodes @data of @size bytes (jpeg, png, etc) to @image scaled down to fit in @max_size (see |get_image_fit_scale|), so large scans
+    // don't have to be decoded and uploaded in full resolution to be shown in a small window.
+    // Jpeg images are scaled by libjpeg while they are decoded (1/2, 1/4 or 1/8) to the smallest size that is not smaller than the target size,
+    // then the image is resampled to the target size with an area filter.
+    // @original_size is set to the size of the image before it was scaled. Can be called from any thread
+    bool decode_image_scaled(const char *data, size_t size, sf::Vector2u max_size, sf::Image &image, sf::Vector2u &original_size);
+    // |decode_image_scaled| for the beginning of a jpeg file that is still downloading. The rows that have not been downloaded yet are gray
+    // and progressive jpegs are as sharp as the scans that have been downloaded.
+    // Returns false if the file is not a jpeg or if the header has not been downloaded yet
+    bool decode_partial_image_scaled(const char *data, size_t size, sf::Vector2u max_size, sf::Image &image, sf::Vector2u &original_size);
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <functional>
+#include <stdio.h>
+
+namespace QuickMedia {
+    // Records the duration of an operation, for finding out what is slow. Durations are grouped by @name,
+    // which has to be a string literal. Can be called from any thread
+    void instrumentation_record(const char *name, double duration_ms);
+
+    using InstrumentationDumpCallback = std::function<void(FILE *file)>;
+    // For statistics that are not durations. @callback is called by |instrumentation_dump| and has to be thread safe
+    void instrumentation_add_dump_callback(InstrumentationDumpCallback callback);
+
+    // Writes the number of recorded durations and their average, min and max for each name to @file
+    void instrumentation_dump(FILE *file);
+}
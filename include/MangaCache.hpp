@@ -0,0 +1,72 @@
+#pragma once
+
+#include "Path.hpp"
+#include <string>
+#include <unordered_map>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <stdint.h>
+#include <time.h>
+
+namespace QuickMedia {
+    // Keeps the size of the downloaded manga chapters (~/.cache/quickmedia/manga) under a budget by removing the chapters that were read least recently.
+    // The size and last access time of each chapter is kept in an index file in the cache directory, so the cache doesn't have to be walked to find them.
+    // Chapters of pinned manga (bookmarked or kept for offline reading) and the chapter that is being read are never removed.
+    // Chapters are removed and the index is saved in a background thread. Can be used from multiple threads
+    class MangaCache {
+    public:
+        // @max_size is in bytes, 0 means no limit
+        MangaCache(const Path &manga_cache_dir, uint64_t max_size);
+        ~MangaCache();
+        MangaCache(const MangaCache&) = delete;
+        MangaCache& operator=(const MangaCache&) = delete;
+
+        // @manga_id and @chapter_dir are the names of the directories of the manga and the chapter in the cache directory.
+        // The chapter is used now, and it's not removed until another chapter is opened
+        void open_chapter(const std::string &manga_id, const std::string &chapter_dir);
+        // Called when pages have been added to the chapter. Updates the size of the chapter from its files
+        void update_chapter_size(const std::string &manga_id, const std::string &chapter_dir);
+        void set_pinned(const std::string &manga_id, bool pinned);
+        bool is_pinned(const std::string &manga_id);
+    private:
+        struct Chapter {
+            uint64_t size = 0;
+            time_t last_access = 0;
+        };
+
+        struct Manga {
+            bool pinned = false;
+            std::unordered_map<std::string, Chapter> chapters;
+        };
+
+        void cache_thread_func();
+        // Returns false if there is no index file or it's invalid
+        bool load_index();
+        // Creates the index from the files in the cache directory, for caches from before the index was used
+        void create_index_from_files();
+        // Called with |mutex| locked, which is unlocked while the index is written
+        void save_index(std::unique_lock<std::mutex> &lock);
+        // Removes the least recently used chapters until the cache is under the budget. Called with |mutex| locked, which is unlocked while files are removed
+        void evict_chapters(std::unique_lock<std::mutex> &lock);
+        void remove_evicted_dirs();
+        // Called with |mutex| locked
+        void check_budget();
+    private:
+        Path manga_cache_dir;
+        Path index_path;
+        uint64_t max_size;
+        uint64_t total_size;
+        bool running;
+        bool index_dirty;
+        // Set when the cache has grown over the budget or chapters have been unpinned, so chapters are not looked for on every change
+        bool evict_needed;
+        int num_evicted_dirs;
+        std::string open_manga_id;
+        std::string open_chapter_dir;
+        std::unordered_map<std::string, Manga> manga;
+        std::mutex mutex;
+        std::condition_variable cond;
+        std::thread cache_thread;
+    };
+}
@@ -8,6 +8,7 @@ namespace QuickMedia {
         VIDEO_CONTENT,
         EPISODE_LIST,
         IMAGES,
+        IMAGES_CONTINUOUS,
         CONTENT_LIST,
         CONTENT_DETAILS,
         IMAGE_BOARD_THREAD_LIST,
@@ -0,0 +1,114 @@
+#pragma once
+
+#include "Path.hpp"
+#include <SFML/Graphics/Texture.hpp>
+#include <SFML/Graphics/Image.hpp>
+#include <map>
+#include <unordered_map>
+#include <deque>
+#include <unordered_set>
+#include <memory>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+
+namespace QuickMedia {
+    class TaskQueue;
+    class ChapterPack;
+
+    enum class PageState {
+        DOWNLOADING,
+        // The page is still downloading, the image is what has been downloaded so far
+        PARTIAL,
+        DECODING,
+        LOADED,
+        FAILED
+    };
+
+    struct DecodedPage {
+        PageState state = PageState::DECODING;
+        // The size of the page image file. Only set if |has_image|
+        sf::Vector2u size;
+        // Only set if |has_image|. The image is scaled down to the max page size when it's decoded, so it can be smaller than |size|
+        std::shared_ptr<sf::Image> image;
+        // The page is decoded again because the max page size has increased (the window was made larger) or more of the page has been downloaded
+        // since it was decoded. |image| is used until then
+        bool outdated = false;
+        // The image is uploaded in tiles of |PageDecoder::get_tile_height| rows, since pages (webtoon strips) can be taller
+        // than the maximum texture size. A tile is nullptr if it's not uploaded
+        std::vector<std::unique_ptr<sf::Texture>> tiles;
+
+        bool has_image() const { return state == PageState::LOADED || state == PageState::PARTIAL; }
+    };
+
+    // Decodes the pages of a chapter in background threads and keeps a ring of decoded pages around the current pages.
+    // The decoded images are given to the main thread by tasks that are posted to @main_thread_tasks, so the page that shows them
+    // is woken up when a page has been decoded.
+    // All functions have to be called from the main thread
+    class PageDecoder {
+    public:
+        PageDecoder(TaskQueue &main_thread_tasks);
+        ~PageDecoder();
+        PageDecoder(const PageDecoder&) = delete;
+        PageDecoder& operator=(const PageDecoder&) = delete;
+
+        // Pages are read from the chapter pack in @chapter_cache_dir. Page n of the chapter that is not in the pack yet is the file @chapter_cache_dir/n+1,
+        // or @chapter_cache_dir/n+1.part while it's downloading. Does nothing if the chapter is already set
+        void set_chapter(const Path &chapter_cache_dir, int num_pages);
+        // Same as |set_page_range| with only @page_index visible
+        void set_current_page(int page_index);
+        // Keeps the pages from @first_page to @last_page, the page before them and the next NUM_PAGES_AHEAD pages decoded.
+        // The pages closest to @first_page are decoded first
+        void set_page_range(int first_page, int last_page);
+        // Pages that were not downloaded yet are decoded again, with the data that has been downloaded since then
+        void check_downloaded_pages();
+        // Returns nullptr if @page_index is not in the ring
+        const DecodedPage* get_page(int page_index) const;
+        // The size of the page image is remembered after the page leaves the ring, so the layout of the continuous scroll mode doesn't change
+        // when pages are decoded again. Returns false if the page has not been decoded in this chapter
+        bool get_page_size(int page_index, sf::Vector2u &size) const;
+
+        // Pages are decoded scaled down to fit in @max_size, 0 for a component means that it doesn't limit the size.
+        // Pages that were decoded with a smaller max size are decoded again with the new size, the full size pages are kept in the cache dir.
+        // The max size should be set before the pages are set, so the pages are not decoded twice
+        void set_max_page_size(sf::Vector2u max_size);
+        // If true, all tiles of a page are uploaded as soon as the page has been decoded, so turning the page is only a texture swap.
+        // Otherwise only the tiles that are asked for with |update_tiles| are uploaded. True by default
+        void set_upload_decoded_pages(bool upload);
+        unsigned int get_tile_height() const { return tile_height; }
+        // Uploads the tiles of the page that intersect the image rows from @top to @bottom and frees the other tiles of the page
+        void update_tiles(int page_index, unsigned int top, unsigned int bottom);
+        // Frees the tiles of the pages that are not from @first_page to @last_page
+        void free_tiles_outside(int first_page, int last_page);
+    private:
+        void queue_pages();
+        void decode_thread_func();
+        void on_page_decoded(int decode_chapter_id, int decode_download_check, int page_index, PageState state, std::shared_ptr<sf::Image> image, sf::Vector2u image_file_size);
+    private:
+        TaskQueue &main_thread_tasks;
+        // Only accessed by the main thread
+        std::map<int, DecodedPage> pages;
+        std::unordered_map<int, sf::Vector2u> page_sizes;
+        int current_page;
+        int num_pages;
+        bool upload_decoded_pages;
+        unsigned int tile_height;
+
+        // Shared with the decode threads
+        std::mutex mutex;
+        std::condition_variable queue_cond;
+        bool running;
+        // Changed every time the chapter changes, so pages that are decoded for the previous chapter are ignored
+        int chapter_id;
+        // Incremented by |check_downloaded_pages|. A page that was not downloaded when it was decoded might have been downloaded
+        // before the main thread was told about it, in which case it's decoded again
+        int download_check;
+        sf::Vector2u max_page_size;
+        Path chapter_cache_dir;
+        std::shared_ptr<ChapterPack> chapter_pack;
+        std::deque<int> queue;
+        std::unordered_set<int> decoding_pages;
+        std::vector<std::thread> decode_threads;
+    };
+}
@@ -22,6 +22,16 @@ typedef int (*ProgramOutputCallback)(char *data, int size, void *userdata);
 */
 int exec_program(const char **args, ProgramOutputCallback output_callback, void *userdata);
 
+/* Return 0 if you want the program to keep running */
+typedef int (*ProgramIdleCallback)(void *userdata);
+
+/*
+    Same as |exec_program|, but @idle_callback is also called every @idle_interval_ms milliseconds while the program doesn't write anything,
+    so the program can be stopped when it's stuck (for example a download that doesn't receive any data). The program is killed if
+    @idle_callback returns non-zero, and -4 is returned
+*/
+int exec_program_cancellable(const char **args, ProgramOutputCallback output_callback, ProgramIdleCallback idle_callback, int idle_interval_ms, void *userdata);
+
 // Return the exit status, or a negative value if waiting failed
 int wait_program(pid_t process_id);
 
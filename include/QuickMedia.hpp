@@ -4,6 +4,7 @@
 #include "SearchBar.hpp"
 #include "Page.hpp"
 #include "Storage.hpp"
+#include "TaskQueue.hpp"
 #include <vector>
 #include <memory>
 #include <SFML/Graphics/Font.hpp>
@@ -12,10 +13,19 @@
 #include <unordered_set>
 #include <future>
 #include <stack>
+#include <initializer_list>
+#include <SFML/System/Clock.hpp>
+
+typedef struct _XDisplay Display;
 
 namespace QuickMedia {
     class Plugin;
     class Manganelo;
+    class VideoPlayer;
+    class StreamResolver;
+    class PageDecoder;
+    class MangaCache;
+    class SeriesDownloader;
     
     class Program {
     public:
@@ -24,6 +34,8 @@ namespace QuickMedia {
         int run(int argc, char **argv);
 
         Plugin* get_current_plugin() { return current_plugin; }
+        // Background work posts to this when it's done, so the page wakes up for it
+        TaskQueue& get_main_thread_tasks() { return main_thread_tasks; }
     private:
         void base_event_handler(sf::Event &event, Page previous_page, bool handle_key_press = true, bool clear_on_escape = true, bool handle_searchbar = true);
         void search_suggestion_page();
@@ -31,19 +43,31 @@ namespace QuickMedia {
         void video_content_page();
         void episode_list_page();
         void image_page();
+        // Shows the pages of the chapter under each other, for webtoons
+        void image_continuous_page();
         void content_list_page();
         void content_details_page();
         void image_board_thread_list_page();
         void image_board_thread_page();
 
-        enum class LoadImageResult {
-            OK,
-            FAILED,
-            DOWNLOAD_IN_PROGRESS
-        };
+        // Waits until the window has events, a task has been posted to |main_thread_tasks|, one of @fds is readable or @timeout_ms has passed
+        // (-1 to wait as long as possible). The posted tasks are run before this returns.
+        // Returns true if the window has to be redrawn, because it was exposed or tasks were run
+        bool wait_for_events(int timeout_ms, std::initializer_list<int> fds = {});
+        // |wait_for_events| for pages that show the search bar and @page_body. Returns true if the page has to be redrawn
+        bool wait_for_body_page_events(Body *page_body, int timeout_ms = -1);
 
-        LoadImageResult load_image_by_index(int image_index, sf::Texture &image_texture, sf::String &error_message);
         void download_chapter_images_if_needed(Manganelo *image_plugin);
+        // Queues all chapters of the current manga for offline reading in |series_downloader|
+        void download_series();
+        // Exports the downloaded pages of @chapter of the current manga to a cbz file in ~/Downloads
+        void export_chapter_cbz(const std::string &chapter);
+        // Prepares the current chapter for the image pages. Returns false and goes back to the episode list if it fails
+        bool load_chapter_images(int &num_images);
+        void save_chapter_progress(int num_images);
+        // Returns Page::IMAGES or Page::IMAGES_CONTINUOUS, depending on which one was used last for the manga
+        Page get_image_view_page();
+        void toggle_image_view_page();
         void select_episode(BodyItem *item, bool start_from_beginning);
 
         // Returns Page::EXIT if empty
@@ -51,6 +75,10 @@ namespace QuickMedia {
     private:
         sf::RenderWindow window;
         sf::Vector2f window_size;
+        // Gets a copy of the input events of the window, SFML doesn't have a way to wait for events with a timeout
+        Display *event_display;
+        sf::Clock window_event_timer;
+        TaskQueue main_thread_tasks;
         sf::Font font;
         sf::Font bold_font;
         Body *body;
@@ -75,7 +103,22 @@ namespace QuickMedia {
         std::unordered_set<std::string> watched_videos;
         std::future<BodyItems> search_suggestion_future;
         std::future<void> image_download_future;
+        // The related media of the video that is playing. Kept out of the video page, since the destructor of a future from std::async waits until it's ready.
+        // Futures of videos that are not playing anymore are kept in |abandoned_related_media_futures| until they are ready
+        std::future<BodyItems> related_media_future;
+        std::vector<std::future<BodyItems>> abandoned_related_media_futures;
         std::string downloading_chapter_url;
         bool image_download_cancel;
+        // Kept between video pages, so mpv doesn't have to be launched for every video
+        std::unique_ptr<VideoPlayer> video_player;
+        // Only for plugins that can resolve video streams
+        std::unique_ptr<StreamResolver> stream_resolver;
+        std::string last_resolve_request_url;
+        // Kept between image pages, so the decoded pages are kept when going back to the same chapter
+        std::unique_ptr<PageDecoder> page_decoder;
+        // Only for manga plugins. Removes the chapters that were read least recently when the cache is full
+        std::unique_ptr<MangaCache> manga_cache;
+        // Only for manga plugins. Downloads whole manga in the background
+        std::unique_ptr<SeriesDownloader> series_downloader;
     };
 }
\ No newline at end of file
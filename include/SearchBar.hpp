@@ -16,7 +16,10 @@ namespace QuickMedia {
     public:
         SearchBar(sf::Font &font, sf::Texture &plugin_logo);
         void draw(sf::RenderWindow &window, bool draw_shadow = true);
-        void update();
+        // Calls onTextUpdateCallback once the text hasn't changed for text_autosearch_delay milliseconds. Returns true if it was called
+        bool update();
+        // Milliseconds until |update| has to be called, or -1 if the text hasn't changed
+        int get_update_timeout_ms() const;
         void onWindowResize(const sf::Vector2f &window_size);
         void onTextEntered(sf::Uint32 codepoint);
         void clear();
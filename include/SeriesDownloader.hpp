@@ -0,0 +1,116 @@
+#pragma once
+
+#include "Path.hpp"
+#include "DownloadUtils.hpp"
+#include <json/value.h>
+#include <string>
+#include <vector>
+#include <deque>
+#include <unordered_map>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <functional>
+#include <stdint.h>
+
+namespace QuickMedia {
+    class Manganelo;
+    class MangaCache;
+    class ChapterPack;
+
+    // Downloads page @page_index of a chapter from one of @urls (mirrors of the page) to @chapter_pack. Does nothing if the page is already in the pack.
+    // The page is downloaded to the file @page_index + 1 in @chapter_cache_dir while it's downloading (see |download_to_file_from_mirrors|).
+    // Pages that are downloaded in the @background (by |SeriesDownloader|) are downloaded to another file, so the image page can download the same page at the same time.
+    // Returns DownloadResult::ERR if the page could not be written
+    DownloadResult download_chapter_page(ChapterPack &chapter_pack, const Path &chapter_cache_dir, int page_index, const std::vector<std::string> &urls,
+        DownloadProgressCallback progress_callback, const std::vector<CommandArg> &additional_args, bool use_tor, bool background = false);
+
+    struct SeriesChapter {
+        std::string title;
+        std::string url;
+        // The name of the directory of the chapter in the directory of the manga in the cache
+        std::string dir;
+    };
+
+    enum class ChapterDownloadState {
+        QUEUED,
+        DOWNLOADING,
+        FINISHED,
+        FAILED
+    };
+
+    struct ChapterDownloadProgress {
+        ChapterDownloadState state = ChapterDownloadState::QUEUED;
+        int downloaded_pages = 0;
+        // 0 until the pages of the chapter have been found
+        int num_pages = 0;
+    };
+
+    // Downloads all chapters of manga for offline reading, a few chapters at a time in background threads.
+    // The queue is saved to ~/.config/quickmedia/manga_downloads.json, so the downloads continue when the program is started again.
+    // Chapters that have been downloaded completely are skipped, and the pages that were downloaded before are not downloaded again.
+    // The chapter that is being read is downloaded by the image page instead (see |set_reading_chapter|)
+    class SeriesDownloader {
+    public:
+        // @max_download_rate is the number of bytes per second that all downloads can use together, 0 is unlimited.
+        // @progress_callback is called from the download threads when the progress of a chapter changes. Can be nullptr
+        SeriesDownloader(Manganelo *plugin, MangaCache *manga_cache, int max_download_rate, std::function<void()> progress_callback);
+        ~SeriesDownloader();
+        SeriesDownloader(const SeriesDownloader&) = delete;
+        SeriesDownloader& operator=(const SeriesDownloader&) = delete;
+
+        // @manga_id is the name of the directory of the manga in the cache. Chapters that are queued already are not queued again.
+        // Returns the number of chapters that were queued
+        int queue_series(const std::string &manga_id, const std::string &manga_name, const std::vector<SeriesChapter> &chapters);
+        // Returns false if the chapter with @chapter_url has not been queued since the program was started
+        bool get_chapter_progress(const std::string &chapter_url, ChapterDownloadProgress &progress);
+        // The chapter is downloaded by the image page while it's being read. Stops downloading the chapter without waiting for the page that is downloading to stop.
+        // The chapter is downloaded later, when another chapter is read or |release_reading_chapter| is called
+        void set_reading_chapter(const std::string &chapter_url);
+        // Does nothing if another chapter is being read now
+        void release_reading_chapter(const std::string &chapter_url);
+    private:
+        struct QueuedChapter {
+            std::string manga_id;
+            SeriesChapter chapter;
+        };
+
+        // The chapter that a download thread is downloading
+        struct ActiveChapter {
+            QueuedChapter queued_chapter;
+            bool active = false;
+            bool cancel = false;
+        };
+
+        void download_thread_func(int thread_index);
+        // Returns true if all pages were downloaded
+        bool download_chapter(int thread_index, const QueuedChapter &queued_chapter);
+        void load_queue();
+        // Called with |mutex| locked. The lock is released while the file is written
+        void save_queue(std::unique_lock<std::mutex> &lock);
+        void write_queue(const Json::Value &json_root, uint64_t queue_version);
+        void set_progress(const std::string &chapter_url, ChapterDownloadState state, int downloaded_pages, int num_pages);
+    private:
+        Manganelo *plugin;
+        MangaCache *manga_cache;
+        std::vector<CommandArg> download_args;
+        std::function<void()> progress_callback;
+        Path queue_path;
+        bool running;
+        std::mutex mutex;
+        std::condition_variable queue_cond;
+        std::deque<QueuedChapter> queue;
+        // Kept in the saved queue, so they are tried again when the program is started again
+        std::vector<QueuedChapter> failed_chapters;
+        std::unordered_map<std::string, std::string> manga_names;
+        std::unordered_map<std::string, ChapterDownloadProgress> chapter_progress;
+        std::string reading_chapter_url;
+        std::vector<ActiveChapter> active_chapters;
+        std::vector<std::thread> download_threads;
+        // Incremented with |mutex| locked every time the queue is saved, so an older queue doesn't replace a newer one
+        uint64_t queue_save_counter = 0;
+        // Guarded by |save_mutex|
+        uint64_t saved_queue_version = 0;
+        std::mutex save_mutex;
+    };
+}
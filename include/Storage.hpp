@@ -20,6 +20,8 @@ namespace QuickMedia {
     int create_directory_recursive(const Path &path);
     FileType get_file_type(const Path &path);
     int file_get_content(const Path &path, std::string &result);
+    // Returns -1 if the file doesn't exist
+    long file_get_size(const Path &path);
     int file_overwrite(const Path &path, const std::string &data);
     int create_lock_file(const Path &path);
     void for_files_in_dir(const Path &path, FileIteratorCallback callback);
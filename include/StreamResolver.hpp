@@ -0,0 +1,68 @@
+#pragma once
+
+#include <string>
+#include <deque>
+#include <unordered_map>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+#include <functional>
+#include <time.h>
+
+namespace QuickMedia {
+    struct ResolvedStream {
+        std::string video_url;
+        // Empty if the audio is in the video stream
+        std::string audio_url;
+        time_t expire_time;
+    };
+
+    enum class StreamResolveResult {
+        OK,
+        IN_PROGRESS,
+        ERR
+    };
+
+    // Resolves urls of video pages (youtube, pornhub) to the urls of their streams with youtube-dl in a background thread,
+    // so mpv doesn't have to run youtube-dl when the video is played
+    class StreamResolver {
+    public:
+        // @resolved_callback is called from the resolve thread when a url has been resolved or failed to resolve. Can be nullptr
+        StreamResolver(bool use_tor, std::function<void()> resolved_callback = nullptr);
+        ~StreamResolver();
+        StreamResolver(const StreamResolver&) = delete;
+        StreamResolver& operator=(const StreamResolver&) = delete;
+
+        // Does nothing if @url is already resolved or being resolved. The url that was requested last is resolved first
+        void request(const std::string &url);
+        // Doesn't wait for @url to be resolved. Returns StreamResolveResult::ERR if @url has not been requested,
+        // failed to resolve or if the resolved stream has expired
+        StreamResolveResult get(const std::string &url, ResolvedStream &result);
+    private:
+        void resolve_thread_func();
+        void remove_expired_streams();
+    private:
+        enum class State {
+            QUEUED,
+            RESOLVING,
+            RESOLVED,
+            FAILED
+        };
+
+        struct Stream {
+            State state;
+            ResolvedStream resolved_stream;
+        };
+
+        bool use_tor;
+        std::function<void()> resolved_callback;
+        // Also read by the resolve thread without |mutex| while youtube-dl is running, so youtube-dl can be killed when the resolver is destroyed
+        std::atomic<bool> running;
+        std::mutex mutex;
+        std::condition_variable queue_cond;
+        std::deque<std::string> queue;
+        std::unordered_map<std::string, Stream> streams;
+        std::thread resolve_thread;
+    };
+}
@@ -11,4 +11,16 @@ namespace QuickMedia {
     void string_replace_all(std::string &str, const std::string &old_str, const std::string &new_str);
     std::string strip(const std::string &str);
     bool string_ends_with(const std::string &str, const std::string &ends_with_str);
+    // Percent-encodes everything except unreserved characters (rfc 3986).
+    // @output needs to have room for at least 3 * @size bytes. Returns the number of bytes written to @output
+    size_t url_param_encode(const char *str, size_t size, char *output);
+    void url_param_encode_append(const char *str, size_t size, std::string &result);
+    std::string url_param_encode(const std::string &param);
+    // Invalid percent-encoded sequences are kept as they are
+    std::string url_param_decode(const std::string &param);
+    // Appends @key=@value to @url, where @value is percent-encoded. The parameter is separated with '?' or '&' depending on
+    // if @url already has a query
+    void url_append_query_param(std::string &url, const char *key, const std::string &value);
+    // Decodes all html named (&amp;) and numeric (&#39; and &#x27;) character references in @str to utf8
+    void html_unescape_sequences(std::string &str);
 }
\ No newline at end of file
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <functional>
+#include <vector>
+#include <mutex>
+
+namespace QuickMedia {
+    using Task = std::function<void()>;
+
+    // Background threads post tasks that are run on the main thread by |run_tasks|. The fd of the queue becomes readable
+    // when a task has been posted, so the main thread can wait for it together with window events instead of checking
+    // background work every frame
+    class TaskQueue {
+    public:
+        TaskQueue();
+        ~TaskQueue();
+        TaskQueue(const TaskQueue&) = delete;
+        TaskQueue& operator=(const TaskQueue&) = delete;
+
+        // Can be called from any thread. @task can be nullptr to only wake up the main thread,
+        // for background work that the main thread checks itself once it's woken up (such as a future)
+        void post(Task task);
+        // Returns the number of tasks that were run, including nullptr tasks
+        int run_tasks();
+        int get_fd() const { return event_fd; }
+    private:
+        int event_fd;
+        std::mutex mutex;
+        std::vector<Task> tasks;
+    };
+}
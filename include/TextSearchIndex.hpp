@@ -0,0 +1,60 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <stdint.h>
+
+namespace QuickMedia {
+    struct TextSearchMatch {
+        std::string document_id;
+        float score;
+    };
+
+    // Inverted index of the words in a set of documents, for searching in memory.
+    // Each document has a revision so that updating a document that hasn't changed doesn't tokenize it again.
+    class TextSearchIndex {
+    public:
+        // Documents that are not updated between @begin_update and @end_update are removed from the index
+        void begin_update();
+        void end_update();
+
+        // Returns true if the document exists with the same revision, in which case it's kept in the index by the current update
+        bool keep_document(const std::string &document_id, int64_t revision);
+        void update_document(const std::string &document_id, const std::string &text, int64_t revision);
+        void remove_document(const std::string &document_id);
+        void clear();
+
+        // Only documents that contain all words in @query are returned, best match first.
+        // The last word in @query also matches words that start with it, since the user is most likely still typing it.
+        // If @max_results is 0 then all matches are returned.
+        std::vector<TextSearchMatch> search(const std::string &query, size_t max_results = 0) const;
+    private:
+        struct Posting {
+            uint32_t document_index;
+            uint32_t term_frequency;
+        };
+
+        struct Document {
+            std::string id;
+            int64_t revision;
+            uint32_t num_words;
+            uint32_t update_generation;
+            bool alive;
+            std::vector<std::string> words; // Unique words, used to remove the postings of the document
+        };
+
+        void remove_document_by_index(uint32_t document_index);
+        float score(const Posting &posting, size_t document_frequency) const;
+    private:
+        std::vector<Document> documents;
+        std::vector<uint32_t> free_document_indices;
+        std::unordered_map<std::string, uint32_t> document_index_by_id;
+        // Sorted, so words that begin with a prefix can be found
+        std::map<std::string, std::vector<Posting>> postings_by_word;
+        size_t num_alive_documents = 0;
+        uint64_t total_num_words = 0;
+        uint32_t update_generation = 0;
+    };
+}
@@ -4,7 +4,11 @@
 #include <SFML/System/Clock.hpp>
 #include <stdio.h>
 #include <functional>
+#include <unordered_map>
+#include <memory>
+#include <vector>
 #include <json/value.h>
+#include <json/reader.h>
 
 #include <sys/un.h>
 #include <X11/Xlib.h>
@@ -13,7 +17,20 @@ namespace QuickMedia {
     using EventCallbackFunc = std::function<void(const char *event_name)>;
     using VideoPlayerWindowCreateCallback = std::function<void(sf::WindowHandle window)>;
 
-    // Currently this video player launches mpv and embeds it into the QuickMedia window
+    // Kept up to date by mpv, see |VideoPlayer::get_playback_state|
+    struct PlaybackState {
+        // Progress is in range [0..1]
+        double progress = 0.0;
+        double time_remaining = 0.0;
+        bool seekable = false;
+        bool paused = false;
+        bool eof_reached = false;
+        // Path or url of the file that is playing
+        std::string path;
+    };
+
+    // Currently this video player launches mpv and embeds it into the QuickMedia window.
+    // mpv is kept running between videos, so the same video player should be reused to play videos.
     class VideoPlayer {
     public:
         enum class Error {
@@ -28,50 +45,91 @@ namespace QuickMedia {
             FAIL_TO_FIND_WINDOW_TIMEOUT,
             UNEXPECTED_WINDOW_ERROR,
             FAIL_TO_READ,
+            // mpv closed the ipc socket, usually because it exited
+            DISCONNECTED,
             READ_TIMEOUT,
             READ_RESPONSE_ERROR,
             READ_INCORRECT_TYPE,
             INIT_FAILED
         };
 
-        // @event_callback is called from another thread
+        // @event_callback is called from |update| with the name of the mpv event. It's also called with "eof-reached"
+        // when the end of the video has been reached, since mpv pauses at the end instead of ending the file (--keep-open),
+        // and with "path-changed" when mpv starts playing another file, for example the next file in the playlist
         VideoPlayer(bool use_tor, EventCallbackFunc event_callback, VideoPlayerWindowCreateCallback window_create_callback);
         ~VideoPlayer();
         VideoPlayer(const VideoPlayer&) = delete;
         VideoPlayer& operator=(const VideoPlayer&) = delete;
 
-        // @path can also be an url if youtube-dl is installed and accessible to mpv
-        Error load_video(const char *path, sf::WindowHandle parent_window);
+        void set_event_callback(EventCallbackFunc event_callback) { this->event_callback = std::move(event_callback); }
+        void set_window_create_callback(VideoPlayerWindowCreateCallback window_create_callback) { this->window_create_callback = std::move(window_create_callback); }
+
+        // Launches mpv without a video, so videos start quicker once they are loaded. Does nothing if mpv is already running.
+        // mpv is launched again if it has exited or its ipc socket has been closed since it was launched
+        Error start(sf::WindowHandle parent_window);
+        // @path can also be an url if youtube-dl is installed and accessible to mpv. Calls |start| if mpv is not running.
+        // @audio_path is optional, for videos that have the audio in a separate stream
+        Error load_video(const char *path, sf::WindowHandle parent_window, const char *audio_path = nullptr);
+        // Stops playing the video (and removes the playlist) but keeps mpv running for the next video
+        Error stop();
+        // Adds the video to the end of the playlist, so it's played after the current video without a pause
+        Error append_video(const char *path, const char *audio_path = nullptr);
         // Should be called every update frame
         Error update();
 
         Error toggle_pause();
 
+        // The callbacks of the requests below are called from |update| once mpv has responded, or with Error::READ_TIMEOUT
+        // if mpv doesn't respond in time. The callbacks are not called if the VideoPlayer is destroyed before that.
+        using RequestCallback = std::function<void(Error error, const Json::Value &data)>;
+
         // Progress is in range [0..1]
-        Error get_progress(double *result);
-        Error get_time_remaining(double *result);
+        Error get_progress(std::function<void(Error error, double progress)> callback);
+        Error get_time_remaining(std::function<void(Error error, double time_remaining)> callback);
         Error set_paused(bool paused);
 
         // Progress is in range [0..1]
         Error set_progress(double progress);
 
-        Error is_seekable(bool *result);
+        Error is_seekable(std::function<void(Error error, bool seekable)> callback);
 
         bool is_connected() const { return connected_to_ipc; }
+
+        // File descriptors that become readable when |update| has something to handle, so the caller can wait on them with poll
+        // instead of calling |update| on a timer. Before mpv has created the ipc socket, the ipc fd is an inotify fd that becomes readable when it's created
+        int get_ipc_fd() const { return connected_to_ipc ? ipc_socket : inotify_fd; }
+        int get_x11_fd() const { return ConnectionNumber(display); }
+
+        // mpv pushes changes to the playback state, so this doesn't communicate with mpv
+        const PlaybackState& get_playback_state() const { return playback_state; }
     private:
         Error set_property(const std::string &property_name, const Json::Value &value);
-        Error get_property(const std::string &property_name, Json::Value *result, Json::ValueType result_type);
+        Error get_property(const std::string &property_name, Json::ValueType result_type, RequestCallback callback);
         Error send_command(const char *cmd, size_t size);
-        Error launch_video_process(const char *path, sf::WindowHandle parent_window);
+        Error send_loadfile_command(const char *path, const char *mode, const char *audio_path);
+        Error try_connect();
+        bool ipc_server_created_event();
         VideoPlayer::Error read_ipc_func();
+        // Closes the ipc socket and fails the requests that are waiting for a response
+        void disconnect();
+        // Kills mpv if it's still running, reaps it and removes its ipc socket, so it can be launched again
+        void terminate_process();
+        void handle_ipc_message(const char *message_begin, const char *message_end);
+        void handle_request_response(const Json::Value &json_root);
+        Error observe_properties();
+        void handle_property_change(const Json::Value &json_root);
+        void remove_timed_out_requests();
     private:
         bool use_tor;
         pid_t video_process_id;
         int ipc_socket;
+        int inotify_fd;
         bool connected_to_ipc;
-        sf::Clock retry_timer;
-        int connect_tries;
-        int find_window_tries;
+        bool ipc_server_created;
+        bool video_requested;
+        sf::Clock connect_timer;
+        sf::Clock find_window_timer;
+        std::string queued_commands;
         struct sockaddr_un ipc_addr;
         char ipc_server_path[L_tmpnam];
         EventCallbackFunc event_callback;
@@ -80,14 +138,20 @@ namespace QuickMedia {
         sf::WindowHandle parent_window;
         Display *display;
         unsigned int request_id;
-        unsigned int expected_request_id;
-        Json::Value request_response_data;
 
-        enum ResponseDataStatus {
-            NONE,
-            OK,
-            ERROR
+        struct PendingRequest {
+            Json::ValueType result_type;
+            RequestCallback callback;
+            sf::Clock timer;
         };
-        ResponseDataStatus response_data_status;
+        std::unordered_map<unsigned int, PendingRequest> pending_requests;
+        PlaybackState playback_state;
+
+        // Messages from mpv are separated by newlines. Bytes in [read_buffer_begin, read_buffer_end) are a message that hasn't been received completely yet
+        std::vector<char> read_buffer;
+        size_t read_buffer_begin;
+        size_t read_buffer_end;
+        std::unique_ptr<Json::CharReader> json_reader;
+        Json::Value ipc_message_json;
     };
 }
@@ -1,6 +1,8 @@
 #pragma once
 
 #include "ImageBoard.hpp"
+#include "../include/TextSearchIndex.hpp"
+#include <unordered_map>
 
 namespace QuickMedia {
     class Fourchan : public ImageBoard {
@@ -10,11 +12,27 @@ namespace QuickMedia {
         SearchResult search(const std::string &url, BodyItems &result_items) override;
         SuggestionResult update_search_suggestions(const std::string &text, BodyItems &result_items) override;
         PluginResult get_threads(const std::string &url, BodyItems &result_items) override;
+        PluginResult search_threads(const std::string &url, const std::string &text, BodyItems &result_items) override;
         PluginResult get_thread_comments(const std::string &list_url, const std::string &url, BodyItems &result_items) override;
         PostResult post_comment(const std::string &board, const std::string &thread, const std::string &captcha_id, const std::string &comment) override;
         bool search_suggestions_has_thumbnails() const override { return false; }
         bool search_results_has_thumbnails() const override { return false; }
         int get_search_delay() const override { return 150; }
         Page get_page_after_search() const override { return Page::IMAGE_BOARD_THREAD_LIST; }
+    private:
+        struct CatalogThread {
+            int64_t last_modified;
+            std::unique_ptr<BodyItem> body_item;
+        };
+
+        // The catalog of a board is kept after it has been downloaded, so threads that haven't been modified
+        // dont have to be parsed and indexed again when the catalog is downloaded again
+        struct BoardCatalog {
+            std::vector<std::string> thread_order;
+            std::unordered_map<std::string, CatalogThread> threads;
+            TextSearchIndex search_index;
+        };
+
+        std::unordered_map<std::string, BoardCatalog> board_catalogs;
     };
 }
\ No newline at end of file
@@ -18,6 +18,9 @@ namespace QuickMedia {
         bool is_image_board() override { return true; }
 
         virtual PluginResult get_threads(const std::string &url, BodyItems &result_items) = 0;
+        // Fills @result_items with the threads from the last call to |get_threads| for @url that match @text, best match first.
+        // All threads are returned in their original order if @text is empty.
+        virtual PluginResult search_threads(const std::string &url, const std::string &text, BodyItems &result_items) = 0;
         virtual PluginResult get_thread_comments(const std::string &list_url, const std::string &url, BodyItems &result_items) = 0;
         virtual PostResult post_comment(const std::string &board, const std::string &thread, const std::string &captcha_id, const std::string &comment) = 0;
     };
@@ -3,30 +3,51 @@
 #include "Plugin.hpp"
 #include <functional>
 #include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+#include <atomic>
+#include <time.h>
 
 namespace QuickMedia {
     // Return false to stop iteration
     using PageCallback = std::function<bool(const std::string &url)>;
 
+    using ImageUrls = std::shared_ptr<const std::vector<std::string>>;
+
     class Manganelo : public Plugin {
     public:
-        Manganelo() : Plugin("manganelo") {}
+        Manganelo();
         SearchResult search(const std::string &url, BodyItems &result_items) override;
         SuggestionResult update_search_suggestions(const std::string &text, BodyItems &result_items) override;
         ImageResult get_image_by_index(const std::string &url, int index, std::string &image_data);
-        ImageResult get_number_of_images(const std::string &url, int &num_images);
+        // @progress_callback is used for the download of the chapter if its image urls are not cached, see |download_to_string|. Can be nullptr
+        ImageResult get_number_of_images(const std::string &url, int &num_images, DownloadProgressCallback progress_callback = nullptr);
         bool search_suggestions_has_thumbnails() const override { return true; }
         bool search_results_has_thumbnails() const override { return false; }
         int get_search_delay() const override { return 150; }
         Page get_page_after_search() const override { return Page::EPISODE_LIST; }
 
-        ImageResult for_each_page_in_chapter(const std::string &chapter_url, PageCallback callback);
+        ImageResult for_each_page_in_chapter(const std::string &chapter_url, PageCallback callback, DownloadProgressCallback progress_callback = nullptr);
+        // Returns @image_url and the same image on the other mirrors of its host, see |download_to_file_from_mirrors|
+        std::vector<std::string> get_page_mirror_urls(const std::string &image_url) const;
     private:
-        // Caches url. If the same url is requested multiple times then the cache is used
-        ImageResult get_image_urls_for_chapter(const std::string &url);
+        // The image urls of the chapters that were used last are cached in memory and on disk, so going back and forth between chapters
+        // (or downloading other chapters in the background) doesn't download and parse the chapter again
+        ImageResult get_image_urls_for_chapter(const std::string &url, ImageUrls &image_urls, DownloadProgressCallback progress_callback);
+        void load_image_urls_cache();
+        void save_image_urls_cache();
     private:
-        std::string last_chapter_url;
-        std::vector<std::string> last_chapter_image_urls;
-        std::mutex image_urls_mutex;
+        struct ChapterImageUrls {
+            ImageUrls image_urls;
+            time_t download_time = 0;
+            // Updated with the shared lock held, so readers don't have to wait for each other
+            std::atomic<uint64_t> last_used{0};
+        };
+
+        std::unordered_map<std::string, ChapterImageUrls> chapter_image_urls;
+        std::atomic<uint64_t> image_urls_use_counter{0};
+        std::shared_mutex image_urls_mutex;
+        // Only one thread saves the cache at a time
+        std::mutex image_urls_save_mutex;
     };
 }
\ No newline at end of file
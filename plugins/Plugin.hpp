@@ -34,8 +34,6 @@ namespace QuickMedia {
         NET_ERR
     };
 
-    void html_unescape_sequences(std::string &str);
-
     class Plugin {
     public:
         Plugin(const std::string &name) : name(name) {}
@@ -65,10 +63,10 @@ namespace QuickMedia {
         virtual int get_search_delay() const = 0;
         virtual bool search_suggestion_is_search() const { return false; }
         virtual Page get_page_after_search() const = 0;
+        // Return true if the video streams of the urls can be resolved with youtube-dl before the video is played
+        virtual bool can_resolve_video_streams() const { return false; }
 
         const std::string name;
         bool use_tor = false;
-    protected:
-        std::string url_param_encode(const std::string &param) const;
     };
 }
\ No newline at end of file
@@ -13,5 +13,6 @@ namespace QuickMedia {
         int get_search_delay() const override { return 500; }
         bool search_suggestion_is_search() const override { return true; }
         Page get_page_after_search() const override { return Page::VIDEO_CONTENT; }
+        bool can_resolve_video_streams() const override { return true; }
     };
 }
\ No newline at end of file
@@ -13,6 +13,7 @@ namespace QuickMedia {
         int get_search_delay() const override { return 350; }
         bool search_suggestion_is_search() const override { return true; }
         Page get_page_after_search() const override { return Page::VIDEO_CONTENT; }
+        bool can_resolve_video_streams() const override { return true; }
     private:
         std::string last_related_media_playlist_id;
         BodyItems last_playlist_data;
@@ -0,0 +1,21 @@
+#pragma once
+
+#include "../include/Body.hpp"
+#include <string>
+
+namespace QuickMedia {
+    // Finds the search results on a youtube search page by scanning for the markup of the titles and thumbnails instead of parsing the page.
+    // Returns false if the page doesn't look like it has search results, in which case |youtube_parse_search_results| should be used instead
+    bool youtube_scan_search_results(const std::string &website_data, BodyItems &result_items);
+    // Parses the whole page with the html parser. Finds the same items as |youtube_scan_search_results| (see tests/youtube_scan.cpp). Returns 0 on success
+    int youtube_parse_search_results(const std::string &website_data, BodyItems &result_items);
+
+    // Finds the related videos on a youtube video page by scanning for the markup of the video list items instead of parsing the page.
+    // The videos of the playlist (if @is_playlist) come first, followed by the related videos that are not in the playlist.
+    // Returns false if nothing was found, in which case |youtube_parse_related_media| should be used instead
+    bool youtube_scan_related_media(const std::string &website_data, bool is_playlist, BodyItems &result_items);
+    // Parses the whole page with the html parser. Finds the same items as |youtube_scan_related_media| (see tests/youtube_scan.cpp). Returns 0 on success
+    int youtube_parse_related_media(const std::string &website_data, bool is_playlist, BodyItems &result_items);
+
+    std::string youtube_remove_index_from_playlist_url(const std::string &url);
+}
@@ -18,7 +18,8 @@ namespace QuickMedia {
         replies_text("", font, 14),
         selected_item(0),
         draw_thumbnails(false),
-        loading_thumbnail(false)
+        loading_thumbnail(false),
+        new_thumbnail(false)
     {
         title_text.setFillColor(sf::Color::White);
         progress_text.setFillColor(sf::Color::White);
@@ -117,7 +118,9 @@ namespace QuickMedia {
                     //result->generateMipmap();
                 }
             }
+            new_thumbnail = true;
             loading_thumbnail = false;
+            program->get_main_thread_tasks().post(nullptr);
         });
         thumbnail_load_thread.detach();
         return result;
@@ -128,11 +131,36 @@ namespace QuickMedia {
         draw(window, pos, size, empty_object);
     }
 
+    void Body::draw(sf::RenderWindow &window, sf::Vector2f pos, sf::Vector2f size, const Json::Value &content_progress) {
+        Json::Value empty_object(Json::objectValue);
+        draw(window, pos, size, content_progress, empty_object);
+    }
+
+    static std::string get_download_progress_text(const Json::Value &item_download_progress) {
+        const Json::Value &state_json = item_download_progress["state"];
+        if(!state_json.isString())
+            return "";
+
+        const std::string state = state_json.asString();
+        if(state == "queued")
+            return "Queued for download";
+        if(state == "finished")
+            return "Downloaded";
+        if(state == "failed")
+            return "Download failed";
+
+        const Json::Value &downloaded_json = item_download_progress["downloaded"];
+        const Json::Value &total_json = item_download_progress["total"];
+        if(!downloaded_json.isNumeric() || !total_json.isNumeric() || total_json.asInt() == 0)
+            return "Downloading";
+        return std::string("Downloading: ") + std::to_string(downloaded_json.asInt()) + "/" + std::to_string(total_json.asInt());
+    }
+
     // TODO: Use a render target for the whole body so all images can be put into one.
     // TODO: Unload thumbnails once they are no longer visible on the screen.
     // TODO: Load thumbnails with more than one thread.
     // TODO: Show chapters (rows) that have been read differently to make it easier to see what hasn't been read yet.
-    void Body::draw(sf::RenderWindow &window, sf::Vector2f pos, sf::Vector2f size, const Json::Value &content_progress) {
+    void Body::draw(sf::RenderWindow &window, sf::Vector2f pos, sf::Vector2f size, const Json::Value &content_progress, const Json::Value &download_progress) {
         const float font_height = title_text.getCharacterSize() + title_text.getLineSpacing() + 4.0f;
         const float image_max_height = 100.0f;
         const float spacing_y = 15.0f;
@@ -157,6 +185,8 @@ namespace QuickMedia {
         selected_border.setFillColor(sf::Color(0, 85, 119));
         const float selected_border_width = 5.0f;
 
+        new_thumbnail = false;
+
         int num_items = items.size();
         if(num_items == 0)
             return;
@@ -302,6 +332,7 @@ namespace QuickMedia {
             window.draw(title_text);
 
             // TODO: Do the same for non-manga content
+            float progress_text_right = item_pos.x + size.x - padding_x;
             const Json::Value &item_progress = content_progress[item->title];
             if(item_progress.isObject()) {
                 const Json::Value &current_json = item_progress["current"];
@@ -309,7 +340,20 @@ namespace QuickMedia {
                 if(current_json.isNumeric() && total_json.isNumeric()) {
                     progress_text.setString(std::string("Page: ") + std::to_string(current_json.asInt()) + "/" + std::to_string(total_json.asInt()));
                     auto bounds = progress_text.getLocalBounds();
-                    progress_text.setPosition(std::floor(item_pos.x + size.x - bounds.width - padding_x), std::floor(item_pos.y + padding_y));
+                    progress_text.setPosition(std::floor(progress_text_right - bounds.width), std::floor(item_pos.y + padding_y));
+                    window.draw(progress_text);
+                    progress_text_right -= bounds.width + 20.0f;
+                }
+            }
+
+            // The download progress is shown to the left of the reading progress
+            const Json::Value &item_download_progress = download_progress[item->title];
+            if(item_download_progress.isObject()) {
+                std::string download_progress_text = get_download_progress_text(item_download_progress);
+                if(!download_progress_text.empty()) {
+                    progress_text.setString(download_progress_text);
+                    auto bounds = progress_text.getLocalBounds();
+                    progress_text.setPosition(std::floor(progress_text_right - bounds.width), std::floor(item_pos.y + padding_y));
                     window.draw(progress_text);
                 }
             }
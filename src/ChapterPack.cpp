@@ -0,0 +1,325 @@
+#include "../include/ChapterPack.hpp"
+#include "../include/Storage.hpp"
+#include <map>
+#include <array>
+#include <algorithm>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace QuickMedia {
+    // Changed if the format of the index changes, packs with another format are ignored
+    static const char INDEX_MAGIC[8] = { 'Q', 'M', 'P', 'A', 'C', 'K', '1', '\0' };
+
+    PackMapping::~PackMapping() {
+        munmap((void*)data, size);
+    }
+
+    ChapterPack::ChapterPack(const Path &chapter_cache_dir) : index_read_size(0) {
+        data_path = chapter_cache_dir;
+        data_path.join("pages.data");
+        index_path = chapter_cache_dir;
+        index_path.join("pages.index");
+        complete_path = chapter_cache_dir;
+        complete_path.join("pages.complete");
+    }
+
+    void ChapterPack::read_new_index_entries() {
+        FILE *file = fopen(index_path.data.c_str(), "rb");
+        if(!file)
+            return;
+
+        if(index_read_size == 0) {
+            char magic[sizeof(INDEX_MAGIC)];
+            if(fread(magic, 1, sizeof(magic), file) != sizeof(magic) || memcmp(magic, INDEX_MAGIC, sizeof(magic)) != 0) {
+                fclose(file);
+                return;
+            }
+            index_read_size = sizeof(magic);
+        } else {
+            fseek(file, index_read_size, SEEK_SET);
+        }
+
+        // An entry that is only partially written (the program was killed while adding a page) is not read
+        IndexEntry entry;
+        while(fread(&entry, 1, sizeof(entry), file) == sizeof(entry)) {
+            index[entry.page_index] = entry;
+            index_read_size += sizeof(entry);
+        }
+        fclose(file);
+    }
+
+    bool ChapterPack::has_page(int page_index) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if(index.find(page_index) != index.end())
+            return true;
+        read_new_index_entries();
+        return index.find(page_index) != index.end();
+    }
+
+    bool ChapterPack::get_page(int page_index, PackedPage &page) {
+        std::lock_guard<std::mutex> lock(mutex);
+        return get_page_locked(page_index, page);
+    }
+
+    bool ChapterPack::get_page_locked(int page_index, PackedPage &page) {
+        auto it = index.find(page_index);
+        if(it == index.end()) {
+            read_new_index_entries();
+            it = index.find(page_index);
+            if(it == index.end())
+                return false;
+        }
+
+        const IndexEntry &entry = it->second;
+        // The data file has grown since it was mapped. The old mapping is unmapped when the pages that use it are released
+        if(!mapping || entry.offset + entry.size > mapping->size) {
+            int fd = open(data_path.data.c_str(), O_RDONLY);
+            if(fd == -1) {
+                perror(data_path.data.c_str());
+                return false;
+            }
+
+            struct stat file_stat;
+            if(fstat(fd, &file_stat) == -1 || (uint64_t)file_stat.st_size < entry.offset + entry.size) {
+                fprintf(stderr, "Page %d is outside the pack data file %s\n", page_index + 1, data_path.data.c_str());
+                close(fd);
+                return false;
+            }
+
+            void *data = mmap(nullptr, file_stat.st_size, PROT_READ, MAP_SHARED, fd, 0);
+            close(fd);
+            if(data == MAP_FAILED) {
+                perror(data_path.data.c_str());
+                return false;
+            }
+            mapping = std::make_shared<PackMapping>((const char*)data, file_stat.st_size);
+        }
+
+        page.mapping = mapping;
+        page.data = mapping->data + entry.offset;
+        page.size = entry.size;
+        return true;
+    }
+
+    static bool write_all(int fd, const char *data, size_t size) {
+        while(size > 0) {
+            ssize_t bytes_written = write(fd, data, size);
+            if(bytes_written == -1) {
+                if(errno == EINTR)
+                    continue;
+                return false;
+            }
+            data += bytes_written;
+            size -= bytes_written;
+        }
+        return true;
+    }
+
+    bool ChapterPack::add_page(int page_index, const std::string &data) {
+        int data_fd = open(data_path.data.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+        if(data_fd == -1) {
+            perror(data_path.data.c_str());
+            return false;
+        }
+
+        // Other instances can add pages to the same pack at the same time (the same chapter downloaded in two places)
+        if(flock(data_fd, LOCK_EX) == -1) {
+            perror(data_path.data.c_str());
+            close(data_fd);
+            return false;
+        }
+
+        // The page was added by another instance while this one was downloading it (the image page and the series downloader download the same page)
+        if(has_page(page_index)) {
+            close(data_fd);
+            return true;
+        }
+
+        // Data that was appended without an index entry (the program was killed while adding a page) is skipped
+        const off_t offset = lseek(data_fd, 0, SEEK_END);
+        // The data is written to disk before the entry, so a page that is in the index is never missing data after a crash
+        if(offset == -1 || !write_all(data_fd, data.data(), data.size()) || fdatasync(data_fd) == -1) {
+            perror(data_path.data.c_str());
+            close(data_fd);
+            return false;
+        }
+
+        bool added = false;
+        int index_fd = open(index_path.data.c_str(), O_RDWR | O_CREAT, 0644);
+        if(index_fd != -1) {
+            IndexEntry entry;
+            entry.page_index = page_index;
+            entry.reserved = 0;
+            entry.offset = offset;
+            entry.size = data.size();
+
+            // An entry that is only partially written (the program was killed while adding a page) is cut off, so the entries after it are not misaligned.
+            // An index without the magic (empty, or another format) is started over
+            struct stat index_stat;
+            char magic[sizeof(INDEX_MAGIC)];
+            off_t index_size = 0;
+            if(fstat(index_fd, &index_stat) == 0 && index_stat.st_size >= (off_t)sizeof(magic) && pread(index_fd, magic, sizeof(magic), 0) == sizeof(magic) && memcmp(magic, INDEX_MAGIC, sizeof(magic)) == 0)
+                index_size = sizeof(magic) + (index_stat.st_size - sizeof(magic)) / sizeof(IndexEntry) * sizeof(IndexEntry);
+
+            added = ftruncate(index_fd, index_size) == 0
+                && lseek(index_fd, index_size, SEEK_SET) != -1
+                && (index_size > 0 || write_all(index_fd, INDEX_MAGIC, sizeof(INDEX_MAGIC)))
+                && write_all(index_fd, (const char*)&entry, sizeof(entry));
+            close(index_fd);
+        }
+
+        if(!added)
+            perror(index_path.data.c_str());
+        close(data_fd);
+        return added;
+    }
+
+    bool ChapterPack::is_complete() const {
+        return get_file_type(complete_path) == FileType::REGULAR;
+    }
+
+    bool ChapterPack::set_complete() {
+        return file_overwrite(complete_path, "") == 0;
+    }
+
+    static std::array<uint32_t, 256> create_crc32_table() {
+        std::array<uint32_t, 256> table;
+        for(uint32_t i = 0; i < 256; ++i) {
+            uint32_t c = i;
+            for(int j = 0; j < 8; ++j) {
+                c = (c & 1) ? 0xEDB88320 ^ (c >> 1) : c >> 1;
+            }
+            table[i] = c;
+        }
+        return table;
+    }
+
+    static uint32_t crc32(const char *data, size_t size) {
+        static const std::array<uint32_t, 256> table = create_crc32_table();
+        uint32_t crc = 0xFFFFFFFF;
+        for(size_t i = 0; i < size; ++i) {
+            crc = table[(crc ^ (unsigned char)data[i]) & 0xFF] ^ (crc >> 8);
+        }
+        return crc ^ 0xFFFFFFFF;
+    }
+
+    static const char* get_image_extension(const char *data, size_t size) {
+        if(size >= 3 && memcmp(data, "\xFF\xD8\xFF", 3) == 0)
+            return "jpg";
+        if(size >= 8 && memcmp(data, "\x89PNG\r\n\x1A\n", 8) == 0)
+            return "png";
+        if(size >= 6 && (memcmp(data, "GIF87a", 6) == 0 || memcmp(data, "GIF89a", 6) == 0))
+            return "gif";
+        if(size >= 12 && memcmp(data, "RIFF", 4) == 0 && memcmp(data + 8, "WEBP", 4) == 0)
+            return "webp";
+        return "jpg";
+    }
+
+    static void append_u16(std::string &str, uint16_t value) {
+        str += (char)(value & 0xFF);
+        str += (char)((value >> 8) & 0xFF);
+    }
+
+    static void append_u32(std::string &str, uint32_t value) {
+        append_u16(str, value & 0xFFFF);
+        append_u16(str, value >> 16);
+    }
+
+    int ChapterPack::export_cbz(const Path &cbz_path) {
+        std::lock_guard<std::mutex> lock(mutex);
+        read_new_index_entries();
+
+        std::map<int, PackedPage> pages;
+        for(auto &it : index) {
+            PackedPage page;
+            if(!get_page_locked(it.first, page))
+                return -1;
+            pages[it.first] = std::move(page);
+        }
+
+        FILE *file = fopen(cbz_path.data.c_str(), "wb");
+        if(!file) {
+            perror(cbz_path.data.c_str());
+            return -1;
+        }
+
+        // Zip with stored (uncompressed) entries, images don't get smaller when they are compressed again
+        std::string central_directory;
+        uint32_t offset = 0;
+        bool write_failed = false;
+        for(auto &it : pages) {
+            const PackedPage &page = it.second;
+            char filename[32];
+            snprintf(filename, sizeof(filename), "%03d.%s", it.first + 1, get_image_extension(page.data, page.size));
+            const uint16_t filename_length = strlen(filename);
+            const uint32_t crc = crc32(page.data, page.size);
+
+            std::string header;
+            append_u32(header, 0x04034b50);
+            append_u16(header, 20); // version needed to extract
+            append_u16(header, 0); // flags
+            append_u16(header, 0); // compression method: stored
+            append_u16(header, 0); // modification time
+            append_u16(header, 0x21); // modification date: 1980-01-01
+            append_u32(header, crc);
+            append_u32(header, page.size);
+            append_u32(header, page.size);
+            append_u16(header, filename_length);
+            append_u16(header, 0); // extra field length
+            header += filename;
+
+            append_u32(central_directory, 0x02014b50);
+            append_u16(central_directory, 20); // version made by
+            append_u16(central_directory, 20); // version needed to extract
+            append_u16(central_directory, 0);
+            append_u16(central_directory, 0);
+            append_u16(central_directory, 0);
+            append_u16(central_directory, 0x21);
+            append_u32(central_directory, crc);
+            append_u32(central_directory, page.size);
+            append_u32(central_directory, page.size);
+            append_u16(central_directory, filename_length);
+            append_u16(central_directory, 0); // extra field length
+            append_u16(central_directory, 0); // comment length
+            append_u16(central_directory, 0); // disk number
+            append_u16(central_directory, 0); // internal attributes
+            append_u32(central_directory, 0); // external attributes
+            append_u32(central_directory, offset);
+            central_directory += filename;
+
+            if(fwrite(header.data(), 1, header.size(), file) != header.size() || fwrite(page.data, 1, page.size, file) != page.size) {
+                write_failed = true;
+                break;
+            }
+            offset += header.size() + page.size;
+        }
+
+        std::string end_of_central_directory;
+        append_u32(end_of_central_directory, 0x06054b50);
+        append_u16(end_of_central_directory, 0); // disk number
+        append_u16(end_of_central_directory, 0); // disk with the central directory
+        append_u16(end_of_central_directory, pages.size());
+        append_u16(end_of_central_directory, pages.size());
+        append_u32(end_of_central_directory, central_directory.size());
+        append_u32(end_of_central_directory, offset);
+        append_u16(end_of_central_directory, 0); // comment length
+
+        if(!write_failed) {
+            write_failed = fwrite(central_directory.data(), 1, central_directory.size(), file) != central_directory.size()
+                || fwrite(end_of_central_directory.data(), 1, end_of_central_directory.size(), file) != end_of_central_directory.size();
+        }
+
+        if(fclose(file) != 0 || write_failed) {
+            fprintf(stderr, "Failed to write to %s\n", cbz_path.data.c_str());
+            remove(cbz_path.data.c_str());
+            return -1;
+        }
+        return pages.size();
+    }
+}
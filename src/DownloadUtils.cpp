@@ -1,6 +1,13 @@
 #include "../include/DownloadUtils.hpp"
 #include "../include/Program.h"
+#include "../include/Storage.hpp"
+#include "../include/StringUtils.hpp"
+#include "../include/HostStats.hpp"
 #include <SFML/System/Clock.hpp>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
 
 static int accumulate_string(char *data, int size, void *userdata) {
     std::string *str = (std::string*)userdata;
@@ -8,14 +15,150 @@ static int accumulate_string(char *data, int size, void *userdata) {
     return 0;
 }
 
+struct StringDownload {
+    std::string *result;
+    QuickMedia::DownloadProgressCallback progress_callback;
+};
+
+static int accumulate_string_cancellable(char *data, int size, void *userdata) {
+    StringDownload *string_download = (StringDownload*)userdata;
+    string_download->result->append(data, size);
+    return string_download->progress_callback(string_download->result->size()) ? 0 : 1;
+}
+
+static int check_string_download_cancelled(void *userdata) {
+    StringDownload *string_download = (StringDownload*)userdata;
+    return string_download->progress_callback(string_download->result->size()) ? 0 : 1;
+}
+
+struct FileDownload {
+    FILE *file;
+    // The size of the part file before the download started
+    long offset;
+    long downloaded_size;
+    bool write_failed;
+    // The server sent the whole file instead of the requested range
+    bool range_ignored;
+    // The response headers (-D -) are written to stdout before the body. Redirects have a block of headers each
+    std::string headers;
+    bool headers_done;
+    int status;
+    // The size of the whole file, -1 if the server didn't say it
+    long expected_size;
+    QuickMedia::DownloadProgressCallback progress_callback;
+    // The progress callback stopped the download
+    bool cancelled;
+    sf::Clock timer;
+    // The time until the headers were received, -1 until then
+    double latency_ms;
+};
+
+static bool header_name_equals(const std::string &line, const char *name, size_t name_length) {
+    return line.size() > name_length && line[name_length] == ':' && strncasecmp(line.c_str(), name, name_length) == 0;
+}
+
+static void parse_header_line(FileDownload *file_download, const std::string &line) {
+    if(header_name_equals(line, "content-length", 14)) {
+        if(file_download->status == 200)
+            file_download->expected_size = strtol(line.c_str() + 15, nullptr, 10);
+    } else if(header_name_equals(line, "content-range", 13)) {
+        // Content-Range: bytes <start>-<end>/<size>
+        const char *range = line.c_str() + 14;
+        const char *range_start = strstr(range, "bytes ");
+        const char *size = strchr(range, '/');
+        if(range_start && size && size[1] != '*' && strtol(range_start + 6, nullptr, 10) == file_download->offset)
+            file_download->expected_size = strtol(size + 1, nullptr, 10);
+    }
+}
+
+// Returns true when the headers of the final response have been parsed. The body data after the headers is left in |headers|
+static bool parse_response_headers(FileDownload *file_download) {
+    while(true) {
+        size_t block_end = file_download->headers.find("\r\n\r\n");
+        size_t separator_length = 4;
+        if(block_end == std::string::npos) {
+            block_end = file_download->headers.find("\n\n");
+            separator_length = 2;
+        }
+        if(block_end == std::string::npos)
+            return false;
+
+        std::string block = file_download->headers.substr(0, block_end);
+        file_download->headers.erase(0, block_end + separator_length);
+
+        // HTTP/1.1 200 OK
+        size_t status_index = block.find(' ');
+        file_download->status = status_index != std::string::npos ? atoi(block.c_str() + status_index + 1) : 0;
+        // Informational responses and redirects that curl follows are followed by the headers of the next response
+        if((file_download->status >= 100 && file_download->status < 200) || (file_download->status >= 300 && file_download->status < 400))
+            continue;
+
+        file_download->expected_size = -1;
+        QuickMedia::string_split(block + "\n", '\n', [file_download](const char *str, size_t size) {
+            std::string line(str, size);
+            if(!line.empty() && line.back() == '\r')
+                line.pop_back();
+            parse_header_line(file_download, line);
+            return true;
+        });
+        file_download->headers_done = true;
+        return true;
+    }
+}
+
+static int write_body(FileDownload *file_download, const char *data, size_t size) {
+    // Flushed right away, so the data can be read from the file while it's downloading
+    if(fwrite(data, 1, size, file_download->file) != size || fflush(file_download->file) != 0) {
+        file_download->write_failed = true;
+        return 1;
+    }
+
+    file_download->downloaded_size += size;
+    if(file_download->progress_callback && !file_download->progress_callback(file_download->offset + file_download->downloaded_size)) {
+        file_download->cancelled = true;
+        return 1;
+    }
+    return 0;
+}
+
+// Called while curl doesn't write anything, so a download that doesn't receive any data can be cancelled too
+static int check_download_cancelled(void *userdata) {
+    FileDownload *file_download = (FileDownload*)userdata;
+    if(file_download->progress_callback && !file_download->progress_callback(file_download->offset + file_download->downloaded_size)) {
+        file_download->cancelled = true;
+        return 1;
+    }
+    return 0;
+}
+
+static int write_to_file(char *data, int size, void *userdata) {
+    FileDownload *file_download = (FileDownload*)userdata;
+    if(file_download->headers_done)
+        return write_body(file_download, data, size);
+
+    file_download->headers.append(data, size);
+    if(!parse_response_headers(file_download))
+        return 0;
+    file_download->latency_ms = file_download->timer.getElapsedTime().asMicroseconds() / 1000.0;
+
+    if(file_download->offset > 0 && file_download->status == 200) {
+        file_download->range_ignored = true;
+        return 1;
+    }
+
+    std::string body = std::move(file_download->headers);
+    file_download->headers.clear();
+    return write_body(file_download, body.data(), body.size());
+}
+
 namespace QuickMedia {
-    // TODO: Add timeout
-    DownloadResult download_to_string(const std::string &url, std::string &result, const std::vector<CommandArg> &additional_args, bool use_tor) {
-        sf::Clock timer;
+    static std::vector<const char*> create_download_args(const std::string &url, const std::vector<CommandArg> &additional_args, bool use_tor, bool compressed = true) {
         std::vector<const char*> args;
         if(use_tor)
             args.push_back("torsocks");
-        args.insert(args.end(), { "curl", "-f", "-H", "Accept-Language: en-US,en;q=0.5", "--compressed", "-s", "-L" });
+        args.insert(args.end(), { "curl", "-f", "-H", "Accept-Language: en-US,en;q=0.5", "-s", "-L" });
+        if(compressed)
+            args.push_back("--compressed");
         for(const CommandArg &arg : additional_args) {
             args.push_back(arg.option.c_str());
             args.push_back(arg.value.c_str());
@@ -23,12 +166,167 @@ namespace QuickMedia {
         args.push_back("--");
         args.push_back(url.c_str());
         args.push_back(nullptr);
-        if(exec_program(args.data(), accumulate_string, &result) != 0)
+        return args;
+    }
+
+    // How often the progress callback is asked if the download should be cancelled while no data is received
+    static const int DOWNLOAD_CANCEL_CHECK_INTERVAL_MS = 250;
+
+    // TODO: Add timeout
+    DownloadResult download_to_string(const std::string &url, std::string &result, const std::vector<CommandArg> &additional_args, bool use_tor, DownloadProgressCallback progress_callback) {
+        sf::Clock timer;
+        std::vector<const char*> args = create_download_args(url, additional_args, use_tor);
+        int exec_result;
+        if(progress_callback) {
+            StringDownload string_download = { &result, std::move(progress_callback) };
+            exec_result = exec_program_cancellable(args.data(), accumulate_string_cancellable, check_string_download_cancelled, DOWNLOAD_CANCEL_CHECK_INTERVAL_MS, &string_download);
+        } else {
+            exec_result = exec_program(args.data(), accumulate_string, &result);
+        }
+        if(exec_result != 0)
             return DownloadResult::NET_ERR;
         fprintf(stderr, "Download duration for %s: %d ms\n", url.c_str(), timer.getElapsedTime().asMilliseconds());
         return DownloadResult::OK;
     }
 
+    // curl exit codes for http errors (such as 416 Range Not Satisfiable) and for servers that can't resume
+    static const int CURL_HTTP_RETURNED_ERROR = 22;
+    static const int CURL_RANGE_ERROR = 33;
+    // curl exit code for downloads that were stopped by --speed-limit/--speed-time or --connect-timeout
+    static const int CURL_OPERATION_TIMEDOUT = 28;
+
+    // A download from a mirror is stopped and tried from the next mirror if it's slower than this many bytes per second for DOWNLOAD_STALL_TIME_SEC
+    // or if it can't connect in that time
+    static const int DOWNLOAD_STALL_SPEED = 1024;
+    static const int DOWNLOAD_STALL_TIME_SEC = 8;
+
+    // Downloads that were stopped by the progress callback or failed to write are not the fault of the host
+    static void record_host_stats(const std::string &url, const FileDownload &file_download, int exec_result) {
+        if(file_download.cancelled || file_download.write_failed)
+            return;
+
+        const double transfer_ms = file_download.latency_ms >= 0.0 ? file_download.timer.getElapsedTime().asMicroseconds() / 1000.0 - file_download.latency_ms : 0.0;
+        host_stats_record_download(get_url_host(url), exec_result == 0 && file_download.headers_done, exec_result == -CURL_OPERATION_TIMEDOUT,
+            file_download.latency_ms, file_download.downloaded_size, transfer_ms);
+    }
+
+    DownloadResult download_to_file(const std::string &url, const Path &path, DownloadProgressCallback progress_callback, const std::vector<CommandArg> &additional_args, bool use_tor) {
+        sf::Clock timer;
+        const Path part_path(path.data + ".part");
+
+        // If resuming fails because the server doesn't support ranges or the part file is not valid anymore, the download is started over once
+        for(int attempt = 0; attempt < 2; ++attempt) {
+            FileDownload file_download;
+            file_download.offset = std::max(0L, file_get_size(part_path));
+            file_download.file = fopen(part_path.data.c_str(), file_download.offset > 0 ? "ab" : "wb");
+            if(!file_download.file) {
+                perror(part_path.data.c_str());
+                return DownloadResult::ERR;
+            }
+            file_download.downloaded_size = 0;
+            file_download.write_failed = false;
+            file_download.range_ignored = false;
+            file_download.headers_done = false;
+            file_download.status = 0;
+            file_download.expected_size = -1;
+            file_download.progress_callback = progress_callback;
+            file_download.cancelled = false;
+            file_download.latency_ms = -1.0;
+
+            // Not compressed, since the range is in bytes of the compressed data then. Images are already compressed anyways
+            std::vector<CommandArg> download_args = additional_args;
+            download_args.push_back({ "-D", "-" });
+            if(file_download.offset > 0)
+                download_args.push_back({ "-C", std::to_string(file_download.offset) });
+            std::vector<const char*> args = create_download_args(url, download_args, use_tor, false);
+
+            file_download.timer.restart();
+            const int exec_result = exec_program_cancellable(args.data(), write_to_file, check_download_cancelled, DOWNLOAD_CANCEL_CHECK_INTERVAL_MS, &file_download);
+            const bool close_failed = fclose(file_download.file) != 0;
+            if(file_download.write_failed || close_failed)
+                return DownloadResult::ERR;
+
+            if(file_download.offset > 0 && (file_download.range_ignored || exec_result == -CURL_RANGE_ERROR || exec_result == -CURL_HTTP_RETURNED_ERROR)) {
+                fprintf(stderr, "Failed to resume download of %s from byte %ld, downloading it from the start\n", url.c_str(), file_download.offset);
+                remove(part_path.data.c_str());
+                continue;
+            }
+
+            record_host_stats(url, file_download, exec_result);
+            // The part file is kept, so the download continues from where it stopped next time
+            if(exec_result != 0 || !file_download.headers_done)
+                return DownloadResult::NET_ERR;
+
+            const long file_size = file_download.offset + file_download.downloaded_size;
+            if(file_download.expected_size >= 0 && file_size != file_download.expected_size) {
+                fprintf(stderr, "Download of %s has the wrong size, expected %ld bytes, got %ld bytes\n", url.c_str(), file_download.expected_size, file_size);
+                if(file_size > file_download.expected_size)
+                    remove(part_path.data.c_str());
+                return DownloadResult::NET_ERR;
+            }
+
+            // The file only gets its real name when it's complete, so a file that exists is never partial
+            if(rename(part_path.data.c_str(), path.data.c_str()) != 0) {
+                perror(path.data.c_str());
+                return DownloadResult::ERR;
+            }
+
+            fprintf(stderr, "Download duration for %s: %d ms\n", url.c_str(), timer.getElapsedTime().asMilliseconds());
+            return DownloadResult::OK;
+        }
+        return DownloadResult::NET_ERR;
+    }
+
+    DownloadResult download_to_file_from_mirrors(std::vector<std::string> urls, const Path &path, DownloadProgressCallback progress_callback, const std::vector<CommandArg> &additional_args, bool use_tor) {
+        host_stats_sort_urls(urls);
+
+        bool cancelled = false;
+        DownloadProgressCallback mirror_progress_callback = [&progress_callback, &cancelled](size_t downloaded_size) {
+            if(progress_callback && !progress_callback(downloaded_size)) {
+                cancelled = true;
+                return false;
+            }
+            return true;
+        };
+
+        // The host that the part file was downloaded from. Mirrors don't necessarily have the same bytes for a file (images can be re-encoded),
+        // so a part file is only continued from the same host and is started over when another host is tried
+        const Path part_path(path.data + ".part");
+        const Path part_host_path(path.data + ".part.host");
+
+        DownloadResult download_result = DownloadResult::NET_ERR;
+        for(size_t i = 0; i < urls.size(); ++i) {
+            const std::string host = get_url_host(urls[i]);
+            std::string part_host;
+            if(file_get_content(part_host_path, part_host) != 0 || part_host != host) {
+                remove(part_path.data.c_str());
+                if(file_overwrite(part_host_path, host) != 0)
+                    return DownloadResult::ERR;
+            }
+
+            // The last mirror is not stopped when it's slow, since there is no other mirror to try
+            std::vector<CommandArg> download_args = additional_args;
+            const bool has_next_mirror = i + 1 < urls.size();
+            if(has_next_mirror) {
+                download_args.push_back({ "--speed-limit", std::to_string(DOWNLOAD_STALL_SPEED) });
+                download_args.push_back({ "--speed-time", std::to_string(DOWNLOAD_STALL_TIME_SEC) });
+                download_args.push_back({ "--connect-timeout", std::to_string(DOWNLOAD_STALL_TIME_SEC) });
+            }
+
+            // The part file is kept when the download fails, so it's continued if the download is tried from the same host again
+            download_result = download_to_file(urls[i], path, mirror_progress_callback, download_args, use_tor);
+            if(download_result != DownloadResult::NET_ERR || cancelled)
+                break;
+
+            if(has_next_mirror)
+                fprintf(stderr, "Download of %s failed or stalled, trying %s\n", urls[i].c_str(), urls[i + 1].c_str());
+        }
+
+        if(download_result == DownloadResult::OK)
+            remove(part_host_path.data.c_str());
+        return download_result;
+    }
+
     std::vector<CommandArg> create_command_args_from_form_data(const std::vector<FormData> &form_data) {
         // TODO: This boundary value might need to change, depending on the content. What if the form data contains the boundary value?
         const std::string boundary = "-----------------------------119561554312148213571335532670";
@@ -47,6 +47,7 @@ namespace QuickMedia {
         result = html.substr(goal_description_begin, goal_description_end - goal_description_begin);
         string_replace_all(result, "<strong>", "");
         string_replace_all(result, "</strong>", "");
+        html_unescape_sequences(result);
         return true;
     }
 
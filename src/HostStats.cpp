@@ -0,0 +1,126 @@
+#include "../include/HostStats.hpp"
+#include "../include/Instrumentation.hpp"
+#include <unordered_map>
+#include <map>
+#include <mutex>
+#include <algorithm>
+
+namespace QuickMedia {
+    // How much a new download changes the estimated speed of a host, so it follows hosts that get slower or faster
+    static const double ESTIMATE_WEIGHT = 0.3;
+    // Failed downloads count as downloads that took this long to respond
+    static const double FAILED_DOWNLOAD_LATENCY_MS = 10000.0;
+    // Downloads smaller than this are mostly latency and don't say much about the throughput
+    static const size_t MIN_THROUGHPUT_SAMPLE_SIZE = 16 * 1024;
+    // Hosts are compared by how long they would take to download a page of this size
+    static const double TYPICAL_DOWNLOAD_SIZE = 300.0 * 1024.0;
+    // The estimated download time of hosts that have not been used
+    static const double UNKNOWN_HOST_ESTIMATE_MS = 2000.0;
+
+    struct HostStats {
+        int num_downloads = 0;
+        int num_failed = 0;
+        int num_stalled = 0;
+        int num_latency_samples = 0;
+        double total_latency_ms = 0.0;
+        size_t total_downloaded_size = 0;
+        double total_transfer_ms = 0.0;
+        double estimated_latency_ms = -1.0;
+        // Bytes per millisecond
+        double estimated_throughput = -1.0;
+    };
+
+    static std::mutex host_stats_mutex;
+    static std::unordered_map<std::string, HostStats> host_stats;
+
+    std::string get_url_host(const std::string &url) {
+        size_t host_start = url.find("://");
+        if(host_start == std::string::npos)
+            return "";
+        host_start += 3;
+        size_t host_end = url.find_first_of("/?#", host_start);
+        return url.substr(host_start, host_end == std::string::npos ? std::string::npos : host_end - host_start);
+    }
+
+    static double update_estimate(double estimate, double sample) {
+        if(estimate < 0.0)
+            return sample;
+        return estimate + (sample - estimate) * ESTIMATE_WEIGHT;
+    }
+
+    // Called with |host_stats_mutex| locked
+    static double get_estimated_download_ms(const HostStats &stats) {
+        if(stats.estimated_latency_ms < 0.0)
+            return UNKNOWN_HOST_ESTIMATE_MS;
+        if(stats.estimated_throughput <= 0.0)
+            return stats.estimated_latency_ms;
+        return stats.estimated_latency_ms + TYPICAL_DOWNLOAD_SIZE / stats.estimated_throughput;
+    }
+
+    static void dump_host_stats(FILE *file) {
+        std::lock_guard<std::mutex> lock(host_stats_mutex);
+        if(host_stats.empty())
+            return;
+
+        // Sorted by name, so the hosts are in the same order in every dump
+        std::map<std::string, const HostStats*> sorted_host_stats;
+        for(auto &it : host_stats) {
+            sorted_host_stats[it.first] = &it.second;
+        }
+
+        fprintf(file, "  Download hosts:\n");
+        for(auto &it : sorted_host_stats) {
+            const HostStats &stats = *it.second;
+            const double avg_latency_ms = stats.num_latency_samples > 0 ? stats.total_latency_ms / stats.num_latency_samples : 0.0;
+            const double avg_throughput_kb = stats.total_transfer_ms > 0.0 ? (stats.total_downloaded_size / 1024.0) / (stats.total_transfer_ms / 1000.0) : 0.0;
+            fprintf(file, "    %s: downloads: %d, failed: %d, stalled: %d, avg latency: %.2f ms, avg throughput: %.2f KB/s, estimated page download: %.2f ms\n",
+                it.first.c_str(), stats.num_downloads, stats.num_failed, stats.num_stalled, avg_latency_ms, avg_throughput_kb, get_estimated_download_ms(stats));
+        }
+    }
+
+    void host_stats_record_download(const std::string &host, bool succeeded, bool stalled, double latency_ms, size_t downloaded_size, double transfer_ms) {
+        static std::once_flag dump_callback_added;
+        std::call_once(dump_callback_added, []() {
+            instrumentation_add_dump_callback(dump_host_stats);
+        });
+
+        std::lock_guard<std::mutex> lock(host_stats_mutex);
+        HostStats &stats = host_stats[host];
+        ++stats.num_downloads;
+        if(!succeeded)
+            ++stats.num_failed;
+        if(stalled)
+            ++stats.num_stalled;
+
+        if(latency_ms >= 0.0) {
+            ++stats.num_latency_samples;
+            stats.total_latency_ms += latency_ms;
+        }
+        stats.estimated_latency_ms = update_estimate(stats.estimated_latency_ms, succeeded && latency_ms >= 0.0 ? latency_ms : FAILED_DOWNLOAD_LATENCY_MS);
+
+        if(downloaded_size >= MIN_THROUGHPUT_SAMPLE_SIZE && transfer_ms > 0.0) {
+            stats.total_downloaded_size += downloaded_size;
+            stats.total_transfer_ms += transfer_ms;
+            stats.estimated_throughput = update_estimate(stats.estimated_throughput, downloaded_size / transfer_ms);
+        }
+    }
+
+    void host_stats_sort_urls(std::vector<std::string> &urls) {
+        std::vector<std::pair<double, std::string>> estimated_urls;
+        {
+            std::lock_guard<std::mutex> lock(host_stats_mutex);
+            for(std::string &url : urls) {
+                auto it = host_stats.find(get_url_host(url));
+                const double estimate = it != host_stats.end() ? get_estimated_download_ms(it->second) : UNKNOWN_HOST_ESTIMATE_MS;
+                estimated_urls.push_back(std::make_pair(estimate, std::move(url)));
+            }
+        }
+
+        std::stable_sort(estimated_urls.begin(), estimated_urls.end(), [](const std::pair<double, std::string> &url1, const std::pair<double, std::string> &url2) {
+            return url1.first < url2.first;
+        });
+        for(size_t i = 0; i < urls.size(); ++i) {
+            urls[i] = std::move(estimated_urls[i].second);
+        }
+    }
+}
@@ -0,0 +1,267 @@
+#include "../include/HtmlMultiSearch.hpp"
+#include <tidy.h>
+#include <tidybuffio.h>
+#include <string.h>
+#include <strings.h>
+
+namespace QuickMedia {
+    static const size_t MAX_QUERIES = 64;
+    static const size_t MAX_STEPS = 63;
+
+    static TidyAttr get_attribute_by_name(TidyNode node, const char *name) {
+        for(TidyAttr attr = tidyAttrFirst(node); attr; attr = tidyAttrNext(attr)) {
+            const char *attr_name = tidyAttrName(attr);
+            if(attr_name && strcmp(name, attr_name) == 0)
+                return attr;
+        }
+        return nullptr;
+    }
+
+    const char* HtmlNode::get_attribute_value(const char *name) const {
+        TidyAttr attr = get_attribute_by_name((TidyNode)node, name);
+        if(attr)
+            return tidyAttrValue(attr);
+        return nullptr;
+    }
+
+    std::string HtmlNode::get_text() const {
+        std::string result;
+        TidyNode child = tidyGetChild((TidyNode)node);
+        if(!child || tidyNodeGetType(child) != TidyNode_Text)
+            return result;
+
+        TidyBuffer tidy_buffer;
+        tidyBufInit(&tidy_buffer);
+        if(tidyNodeGetValue((TidyDoc)doc, child, &tidy_buffer))
+            result.assign((const char*)tidy_buffer.bp, tidy_buffer.size);
+        tidyBufFree(&tidy_buffer);
+        return result;
+    }
+
+    static bool is_whitespace(char c) {
+        return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+    }
+
+    static bool class_list_contains(const char *class_list, const std::string &class_name) {
+        const char *c = class_list;
+        while(*c != '\0') {
+            while(is_whitespace(*c))
+                ++c;
+
+            const char *class_begin = c;
+            while(*c != '\0' && !is_whitespace(*c))
+                ++c;
+
+            if((size_t)(c - class_begin) == class_name.size() && memcmp(class_begin, class_name.data(), class_name.size()) == 0)
+                return true;
+        }
+        return false;
+    }
+
+    bool HtmlMultiSearch::parse_xpath(const std::string &xpath, Query &query) {
+        const char *c = xpath.c_str();
+        while(*c != '\0') {
+            if(*c != '/')
+                return false;
+            ++c;
+
+            bool descendant = false;
+            if(*c == '/') {
+                descendant = true;
+                ++c;
+            }
+
+            Step step;
+            const char *tag_name_begin = c;
+            while(*c != '\0' && *c != '/' && *c != '[')
+                ++c;
+            if(c == tag_name_begin)
+                return false;
+            step.tag_name.assign(tag_name_begin, c - tag_name_begin);
+            if(step.tag_name == "*")
+                step.tag_name.clear();
+
+            if(*c == '[') {
+                ++c;
+                const char *attribute_name_begin = c;
+                while(*c != '\0' && *c != '=' && *c != ']')
+                    ++c;
+                if(*c == '\0' || c == attribute_name_begin)
+                    return false;
+                step.attribute_name.assign(attribute_name_begin, c - attribute_name_begin);
+
+                if(*c == '=') {
+                    ++c;
+                    const char quote = *c;
+                    if(quote != '\'' && quote != '"')
+                        return false;
+                    ++c;
+
+                    const char *attribute_value_end = strchr(c, quote);
+                    if(!attribute_value_end)
+                        return false;
+                    step.attribute_value.assign(c, attribute_value_end - c);
+                    step.has_attribute_value = true;
+                    c = attribute_value_end + 1;
+                }
+
+                if(*c != ']')
+                    return false;
+                ++c;
+            }
+
+            if(query.steps.size() == MAX_STEPS)
+                return false;
+            if(descendant)
+                query.descendant_steps_mask |= (1ULL << query.steps.size());
+            query.steps.push_back(std::move(step));
+        }
+        return !query.steps.empty();
+    }
+
+    bool HtmlMultiSearch::add_query(const std::string &xpath, HtmlNodeCallback callback) {
+        Query query;
+        if(queries.size() == MAX_QUERIES || !parse_xpath(xpath, query))
+            return false;
+        query.callback = std::move(callback);
+        queries.push_back(std::move(query));
+        return true;
+    }
+
+    int HtmlMultiSearch::add_item_query(const std::string &xpath, HtmlNodeCallback begin_callback, HtmlItemEndCallback end_callback) {
+        Query query;
+        if(queries.size() == MAX_QUERIES || !parse_xpath(xpath, query))
+            return -1;
+        query.callback = std::move(begin_callback);
+        query.end_callback = std::move(end_callback);
+        query.is_item = true;
+        queries.push_back(std::move(query));
+        return queries.size() - 1;
+    }
+
+    bool HtmlMultiSearch::add_item_child_query(int item_query, const std::string &xpath, HtmlNodeCallback callback) {
+        Query query;
+        if(item_query < 0 || item_query >= (int)queries.size() || !queries[item_query].is_item)
+            return false;
+        if(queries.size() == MAX_QUERIES || !parse_xpath(xpath, query))
+            return false;
+        query.callback = std::move(callback);
+        query.item_query = item_query;
+        queries.push_back(std::move(query));
+        return true;
+    }
+
+    bool HtmlMultiSearch::step_matches(const Step &step, const void *node) {
+        if(!step.tag_name.empty()) {
+            const char *node_name = tidyNodeGetName((TidyNode)node);
+            if(!node_name || strcasecmp(node_name, step.tag_name.c_str()) != 0)
+                return false;
+        }
+
+        if(step.attribute_name.empty())
+            return true;
+
+        TidyAttr attr = get_attribute_by_name((TidyNode)node, step.attribute_name.c_str());
+        if(!attr)
+            return false;
+
+        if(!step.has_attribute_value)
+            return true;
+
+        const char *attr_value = tidyAttrValue(attr);
+        if(!attr_value)
+            return false;
+
+        if(step.attribute_name == "class")
+            return class_list_contains(attr_value, step.attribute_value);
+        return strcmp(attr_value, step.attribute_value.c_str()) == 0;
+    }
+
+    void HtmlMultiSearch::traverse(const void *node, size_t depth) {
+        const size_t num_queries = queries.size();
+        if(states.size() < (depth + 2) * num_queries)
+            states.resize((depth + 2) * num_queries);
+
+        const size_t states_index = depth * num_queries;
+        const size_t child_states_index = states_index + num_queries;
+        for(TidyNode child = tidyGetChild((TidyNode)node); child; child = tidyGetNext(child)) {
+            TidyNodeType node_type = tidyNodeGetType(child);
+            if(node_type != TidyNode_Start && node_type != TidyNode_StartEnd)
+                continue;
+
+            HtmlNode html_node;
+            html_node.doc = doc;
+            html_node.node = child;
+
+            uint64_t matched_items = 0;
+            for(size_t i = 0; i < num_queries; ++i) {
+                const Query &query = queries[i];
+                const uint64_t state = states[states_index + i];
+                uint64_t matched_steps = 0;
+                for(size_t step = 0; step < query.steps.size(); ++step) {
+                    if((state & (1ULL << step)) && step_matches(query.steps[step], child))
+                        matched_steps |= (1ULL << (step + 1));
+                }
+
+                const uint64_t last_step_bit = 1ULL << query.steps.size();
+                states[child_states_index + i] = (matched_steps & (last_step_bit - 1)) | (state & query.descendant_steps_mask);
+                if(matched_steps & last_step_bit) {
+                    // Item callbacks expect items to begin and end in pairs, so an item can't begin inside an item of the same query
+                    if(!query.is_item)
+                        query.callback(html_node);
+                    else if(!(open_items & (1ULL << i)))
+                        matched_items |= (1ULL << i);
+                }
+            }
+
+            // Child queries of an item start matching from the item node, even if they matched in an outer item
+            for(size_t i = 0; i < num_queries; ++i) {
+                if(!(matched_items & (1ULL << i)))
+                    continue;
+                queries[i].callback(html_node);
+                for(size_t j = 0; j < num_queries; ++j) {
+                    if(queries[j].item_query == (int)i)
+                        states[child_states_index + j] = 1;
+                }
+            }
+
+            open_items |= matched_items;
+            if(node_type == TidyNode_Start)
+                traverse(child, depth + 1);
+            open_items &= ~matched_items;
+
+            for(size_t i = num_queries; i-- > 0;) {
+                if(matched_items & (1ULL << i))
+                    queries[i].end_callback();
+            }
+        }
+    }
+
+    int HtmlMultiSearch::run(const char *html_source) {
+        TidyDoc tidy_doc = tidyCreate();
+        TidyIterator it_opt = tidyGetOptionList(tidy_doc);
+        while (it_opt) {
+            TidyOption opt = tidyGetNextOption(tidy_doc, &it_opt);
+            if (tidyOptGetType(opt) == TidyBoolean)
+                tidyOptSetBool(tidy_doc, tidyOptGetId(opt), no);
+        }
+        tidyOptSetInt(tidy_doc, TidyWrapLen, 0);
+        if(tidyParseString(tidy_doc, html_source) < 0) {
+            tidyRelease(tidy_doc);
+            return -1;
+        }
+
+        // Queries that are not relative to an item can start matching from the root of the document
+        states.resize(queries.size());
+        for(size_t i = 0; i < queries.size(); ++i) {
+            states[i] = queries[i].item_query == -1 ? 1 : 0;
+        }
+
+        doc = tidy_doc;
+        open_items = 0;
+        traverse(tidyGetRoot(tidy_doc), 0);
+        doc = nullptr;
+        tidyRelease(tidy_doc);
+        return 0;
+    }
+}
@@ -0,0 +1,198 @@
+#include "../include/ImageDecoder.hpp"
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <stdio.h>
+#include <setjmp.h>
+#include <jpeglib.h>
+
+namespace QuickMedia {
+    float get_image_fit_scale(sf::Vector2u size, sf::Vector2u max_size) {
+        float scale = 1.0f;
+        if(max_size.x != 0 && size.x > max_size.x)
+            scale = std::min(scale, (float)max_size.x / (float)size.x);
+        if(max_size.y != 0 && size.y > max_size.y)
+            scale = std::min(scale, (float)max_size.y / (float)size.y);
+        return scale;
+    }
+
+    static bool is_jpeg(const char *data, size_t size) {
+        return size >= 3 && (unsigned char)data[0] == 0xFF && (unsigned char)data[1] == 0xD8 && (unsigned char)data[2] == 0xFF;
+    }
+
+    struct JpegErrorManager {
+        jpeg_error_mgr pub;
+        jmp_buf setjmp_buffer;
+    };
+
+    // libjpeg exits the program on errors by default
+    static void jpeg_error_exit(j_common_ptr cinfo) {
+        JpegErrorManager *error_manager = (JpegErrorManager*)cinfo->err;
+        (*cinfo->err->output_message)(cinfo);
+        longjmp(error_manager->setjmp_buffer, 1);
+    }
+
+    // Partial jpegs give a warning for the missing data every time they are decoded
+    static void jpeg_emit_message_silent(j_common_ptr, int) {}
+
+    static sf::Vector2u get_target_size(sf::Vector2u size, sf::Vector2u max_size) {
+        const float scale = get_image_fit_scale(size, max_size);
+        return sf::Vector2u(std::max(1.0f, std::round(size.x * scale)), std::max(1.0f, std::round(size.y * scale)));
+    }
+
+    // @pixels is rgba. The output size is the smallest size that libjpeg can scale to that is not smaller than the size that fits in @max_size.
+    // libjpeg ends the image where the data ends if @data is not the whole file
+    static bool decode_jpeg_scaled(const char *data, size_t size, sf::Vector2u max_size, bool partial, std::vector<unsigned char> &pixels, sf::Vector2u &output_size, sf::Vector2u &original_size) {
+        jpeg_decompress_struct cinfo;
+        JpegErrorManager error_manager;
+        cinfo.err = jpeg_std_error(&error_manager.pub);
+        error_manager.pub.error_exit = jpeg_error_exit;
+        if(partial)
+            error_manager.pub.emit_message = jpeg_emit_message_silent;
+        if(setjmp(error_manager.setjmp_buffer)) {
+            jpeg_destroy_decompress(&cinfo);
+            return false;
+        }
+
+        jpeg_create_decompress(&cinfo);
+        jpeg_mem_src(&cinfo, (const unsigned char*)data, size);
+        jpeg_read_header(&cinfo, TRUE);
+        original_size = sf::Vector2u(cinfo.image_width, cinfo.image_height);
+        const sf::Vector2u target_size = get_target_size(original_size, max_size);
+
+        // Only 1/2, 1/4 and 1/8 are used since they are the fastest (and the only ones supported by libjpeg before version 7)
+        cinfo.scale_num = 1;
+        cinfo.scale_denom = 1;
+        for(unsigned int denom = 8; denom > 1; denom /= 2) {
+            if((cinfo.image_width + denom - 1) / denom >= target_size.x && (cinfo.image_height + denom - 1) / denom >= target_size.y) {
+                cinfo.scale_denom = denom;
+                break;
+            }
+        }
+        cinfo.out_color_space = JCS_EXT_RGBA;
+        cinfo.dct_method = JDCT_ISLOW;
+
+        jpeg_start_decompress(&cinfo);
+        output_size = sf::Vector2u(cinfo.output_width, cinfo.output_height);
+        pixels.resize((size_t)output_size.x * (size_t)output_size.y * 4);
+        while(cinfo.output_scanline < cinfo.output_height) {
+            JSAMPROW row = pixels.data() + (size_t)cinfo.output_scanline * output_size.x * 4;
+            jpeg_read_scanlines(&cinfo, &row, 1);
+        }
+        jpeg_finish_decompress(&cinfo);
+        jpeg_destroy_decompress(&cinfo);
+        return true;
+    }
+
+    // The source pixels that a destination pixel covers, and how much of them it covers
+    struct AreaSpan {
+        int first;
+        std::vector<float> weights;
+    };
+
+    static std::vector<AreaSpan> get_area_spans(unsigned int src_size, unsigned int dst_size) {
+        std::vector<AreaSpan> spans(dst_size);
+        const double ratio = (double)src_size / (double)dst_size;
+        for(unsigned int i = 0; i < dst_size; ++i) {
+            const double start = i * ratio;
+            const double end = std::min((double)src_size, (i + 1) * ratio);
+            AreaSpan &span = spans[i];
+            span.first = (int)start;
+            for(int src = span.first; src < end; ++src) {
+                const double covered = std::min(end, src + 1.0) - std::max(start, (double)src);
+                span.weights.push_back(covered / ratio);
+            }
+        }
+        return spans;
+    }
+
+    static void resample_row_area(const unsigned char *src_row, const std::vector<AreaSpan> &spans_x, float *row) {
+        for(size_t x = 0; x < spans_x.size(); ++x) {
+            const AreaSpan &span = spans_x[x];
+            float pixel[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+            for(size_t i = 0; i < span.weights.size(); ++i) {
+                const unsigned char *src_pixel = src_row + (size_t)(span.first + i) * 4;
+                for(int c = 0; c < 4; ++c) {
+                    pixel[c] += src_pixel[c] * span.weights[i];
+                }
+            }
+            for(int c = 0; c < 4; ++c) {
+                row[x * 4 + c] = pixel[c];
+            }
+        }
+    }
+
+    // Downscales rgba @src with an area (box) filter, which doesn't alias like nearest or bilinear filtering does when downscaling a lot.
+    // Each destination row is the sum of the source rows it covers, resampled horizontally one at a time, so only one source row is kept in floats.
+    // Consecutive destination rows share at most one source row, which is kept from the previous destination row instead of being resampled again.
+    // The channels of a pixel are in the innermost loops so the compiler can vectorize them
+    static void resample_area(const unsigned char *src, sf::Vector2u src_size, unsigned char *dst, sf::Vector2u dst_size) {
+        const std::vector<AreaSpan> spans_x = get_area_spans(src_size.x, dst_size.x);
+        const std::vector<AreaSpan> spans_y = get_area_spans(src_size.y, dst_size.y);
+
+        const size_t row_length = (size_t)dst_size.x * 4;
+        std::vector<float> row(row_length);
+        int row_y = -1;
+        std::vector<float> dst_row(row_length);
+        for(unsigned int y = 0; y < dst_size.y; ++y) {
+            const AreaSpan &span = spans_y[y];
+            std::fill(dst_row.begin(), dst_row.end(), 0.0f);
+            for(size_t i = 0; i < span.weights.size(); ++i) {
+                const int src_y = span.first + (int)i;
+                if(src_y != row_y) {
+                    resample_row_area(src + (size_t)src_y * src_size.x * 4, spans_x, row.data());
+                    row_y = src_y;
+                }
+
+                const float weight = span.weights[i];
+                for(size_t j = 0; j < row_length; ++j) {
+                    dst_row[j] += row[j] * weight;
+                }
+            }
+
+            unsigned char *dst_pixels = dst + (size_t)y * row_length;
+            for(size_t j = 0; j < row_length; ++j) {
+                dst_pixels[j] = (unsigned char)std::min(255.0f, dst_row[j] + 0.5f);
+            }
+        }
+    }
+
+    static bool decode_image_scaled(const char *data, size_t data_size, sf::Vector2u max_size, bool partial, sf::Image &image, sf::Vector2u &original_size) {
+        std::vector<unsigned char> pixels;
+        sf::Vector2u size;
+        bool decoded = false;
+        if(is_jpeg(data, data_size))
+            decoded = decode_jpeg_scaled(data, data_size, max_size, partial, pixels, size, original_size);
+
+        if(partial && !decoded)
+            return false;
+
+        // Other formats and jpegs that libjpeg can't decode to rgba (cmyk) are decoded in full size
+        if(!decoded) {
+            if(!image.loadFromMemory(data, data_size))
+                return false;
+            original_size = image.getSize();
+            size = original_size;
+        }
+
+        const sf::Vector2u target_size = get_target_size(original_size, max_size);
+        if(size.x <= target_size.x && size.y <= target_size.y) {
+            if(decoded)
+                image.create(size.x, size.y, pixels.data());
+            return true;
+        }
+
+        std::vector<unsigned char> scaled_pixels((size_t)target_size.x * target_size.y * 4);
+        resample_area(decoded ? pixels.data() : image.getPixelsPtr(), size, scaled_pixels.data(), target_size);
+        image.create(target_size.x, target_size.y, scaled_pixels.data());
+        return true;
+    }
+
+    bool decode_image_scaled(const char *data, size_t size, sf::Vector2u max_size, sf::Image &image, sf::Vector2u &original_size) {
+        return decode_image_scaled(data, size, max_size, false, image, original_size);
+    }
+
+    bool decode_partial_image_scaled(const char *data, size_t size, sf::Vector2u max_size, sf::Image &image, sf::Vector2u &original_size) {
+        return decode_image_scaled(data, size, max_size, true, image, original_size);
+    }
+}
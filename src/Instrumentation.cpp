@@ -0,0 +1,56 @@
+#include "../include/Instrumentation.hpp"
+#include <mutex>
+#include <map>
+#include <vector>
+#include <string.h>
+
+namespace QuickMedia {
+    struct DurationStats {
+        int count = 0;
+        double total_ms = 0.0;
+        double min_ms = 0.0;
+        double max_ms = 0.0;
+    };
+
+    struct StringLess {
+        bool operator()(const char *str1, const char *str2) const {
+            return strcmp(str1, str2) < 0;
+        }
+    };
+
+    static std::mutex instrumentation_mutex;
+    static std::map<const char*, DurationStats, StringLess> duration_stats;
+    static std::vector<InstrumentationDumpCallback> dump_callbacks;
+
+    void instrumentation_record(const char *name, double duration_ms) {
+        std::lock_guard<std::mutex> lock(instrumentation_mutex);
+        DurationStats &stats = duration_stats[name];
+        if(stats.count == 0 || duration_ms < stats.min_ms)
+            stats.min_ms = duration_ms;
+        if(stats.count == 0 || duration_ms > stats.max_ms)
+            stats.max_ms = duration_ms;
+        stats.total_ms += duration_ms;
+        ++stats.count;
+    }
+
+    void instrumentation_add_dump_callback(InstrumentationDumpCallback callback) {
+        std::lock_guard<std::mutex> lock(instrumentation_mutex);
+        dump_callbacks.push_back(std::move(callback));
+    }
+
+    void instrumentation_dump(FILE *file) {
+        std::lock_guard<std::mutex> lock(instrumentation_mutex);
+        if(duration_stats.empty() && dump_callbacks.empty())
+            return;
+
+        fprintf(file, "Instrumentation:\n");
+        for(auto &it : duration_stats) {
+            const DurationStats &stats = it.second;
+            fprintf(file, "  %s: count: %d, avg: %.2f ms, min: %.2f ms, max: %.2f ms\n", it.first, stats.count, stats.total_ms / stats.count, stats.min_ms, stats.max_ms);
+        }
+
+        for(InstrumentationDumpCallback &callback : dump_callbacks) {
+            callback(file);
+        }
+    }
+}
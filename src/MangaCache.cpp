@@ -0,0 +1,335 @@
+#include "../include/MangaCache.hpp"
+#include "../include/Storage.hpp"
+#include <json/reader.h>
+#include <json/writer.h>
+#include <vector>
+#include <algorithm>
+#include <filesystem>
+#include <memory>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+namespace QuickMedia {
+    // Changes to the index are saved after this long, so it's not written for every downloaded page
+    static const int INDEX_SAVE_DELAY_SEC = 5;
+    // Chapters are removed until the cache is this much of the budget, so a chapter doesn't have to be removed for every chapter that is downloaded
+    static const double EVICT_TARGET_RATIO = 0.9;
+    // Chapters are moved to directories with this prefix before they are removed, so they are gone from the cache at once
+    static const char *EVICTED_DIR_PREFIX = ".evicted-";
+
+    MangaCache::MangaCache(const Path &manga_cache_dir, uint64_t max_size) :
+        manga_cache_dir(manga_cache_dir), max_size(max_size), total_size(0), running(true), index_dirty(false), evict_needed(false), num_evicted_dirs(0)
+    {
+        index_path = manga_cache_dir;
+        index_path.join("cache_index.json");
+        cache_thread = std::thread(&MangaCache::cache_thread_func, this);
+    }
+
+    MangaCache::~MangaCache() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            running = false;
+        }
+        cond.notify_one();
+        cache_thread.join();
+    }
+
+    void MangaCache::open_chapter(const std::string &manga_id, const std::string &chapter_dir) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            open_manga_id = manga_id;
+            open_chapter_dir = chapter_dir;
+            manga[manga_id].chapters[chapter_dir].last_access = time(NULL);
+            index_dirty = true;
+        }
+        cond.notify_one();
+    }
+
+    static uint64_t get_chapter_size(const Path &chapter_dir) {
+        uint64_t size = 0;
+        for(const char *filename : { "pages.data", "pages.index" }) {
+            Path file_path = chapter_dir;
+            file_path.join(filename);
+            long file_size = file_get_size(file_path);
+            if(file_size > 0)
+                size += file_size;
+        }
+        return size;
+    }
+
+    void MangaCache::update_chapter_size(const std::string &manga_id, const std::string &chapter_dir) {
+        Path chapter_path = manga_cache_dir;
+        chapter_path.join(manga_id).join(chapter_dir);
+        const uint64_t size = get_chapter_size(chapter_path);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            Chapter &chapter = manga[manga_id].chapters[chapter_dir];
+            total_size = total_size - chapter.size + size;
+            chapter.size = size;
+            chapter.last_access = time(NULL);
+            index_dirty = true;
+            check_budget();
+        }
+        cond.notify_one();
+    }
+
+    void MangaCache::set_pinned(const std::string &manga_id, bool pinned) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            manga[manga_id].pinned = pinned;
+            index_dirty = true;
+            check_budget();
+        }
+        cond.notify_one();
+    }
+
+    bool MangaCache::is_pinned(const std::string &manga_id) {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = manga.find(manga_id);
+        return it != manga.end() && it->second.pinned;
+    }
+
+    void MangaCache::check_budget() {
+        if(max_size != 0 && total_size > max_size)
+            evict_needed = true;
+    }
+
+    void MangaCache::cache_thread_func() {
+        remove_evicted_dirs();
+        if(!load_index())
+            create_index_from_files();
+
+        std::unique_lock<std::mutex> lock(mutex);
+        check_budget();
+        while(running) {
+            if(evict_needed) {
+                evict_needed = false;
+                evict_chapters(lock);
+            }
+
+            if(index_dirty) {
+                cond.wait_for(lock, std::chrono::seconds(INDEX_SAVE_DELAY_SEC), [this]() { return !running; });
+                save_index(lock);
+                continue;
+            }
+
+            cond.wait(lock, [this]() { return !running || index_dirty || evict_needed; });
+        }
+
+        if(index_dirty)
+            save_index(lock);
+    }
+
+    // Index format: { "manga": { "<manga dir>": { "pinned": bool, "chapters": { "<chapter dir>": [size, last access] } } } }
+    bool MangaCache::load_index() {
+        std::string file_content;
+        if(file_get_content(index_path, file_content) != 0)
+            return false;
+
+        Json::Value json_root;
+        Json::CharReaderBuilder json_builder;
+        std::unique_ptr<Json::CharReader> json_reader(json_builder.newCharReader());
+        std::string json_errors;
+        if(!json_reader->parse(file_content.data(), file_content.data() + file_content.size(), &json_root, &json_errors) || !json_root.isObject()) {
+            fprintf(stderr, "Failed to read the manga cache index, error: %s\n", json_errors.c_str());
+            return false;
+        }
+
+        const Json::Value &json_manga = json_root["manga"];
+        if(!json_manga.isObject())
+            return false;
+
+        std::lock_guard<std::mutex> lock(mutex);
+        for(auto manga_it = json_manga.begin(); manga_it != json_manga.end(); ++manga_it) {
+            const Json::Value &json_chapters = (*manga_it)["chapters"];
+            const Json::Value &json_pinned = (*manga_it)["pinned"];
+            Manga &manga_item = manga[manga_it.name()];
+            if(json_pinned.isBool() && json_pinned.asBool())
+                manga_item.pinned = true;
+            if(!json_chapters.isObject())
+                continue;
+
+            for(auto chapter_it = json_chapters.begin(); chapter_it != json_chapters.end(); ++chapter_it) {
+                const Json::Value &json_chapter = *chapter_it;
+                if(!json_chapter.isArray() || json_chapter.size() != 2 || !json_chapter[0].isIntegral() || !json_chapter[1].isIntegral())
+                    continue;
+
+                // Chapters that were opened before the index was loaded have newer information
+                auto inserted = manga_item.chapters.insert(std::make_pair(chapter_it.name(), Chapter()));
+                if(!inserted.second)
+                    continue;
+                inserted.first->second.size = json_chapter[0].asUInt64();
+                inserted.first->second.last_access = json_chapter[1].asInt64();
+                total_size += inserted.first->second.size;
+            }
+        }
+        return true;
+    }
+
+    // The size of all files in @chapter_path, also the files of pages that are not in the pack (caches from before the pack was used)
+    static void get_chapter_files_size(const std::filesystem::path &chapter_path, uint64_t &size, time_t &last_modified) {
+        std::error_code err;
+        for(auto it = std::filesystem::recursive_directory_iterator(chapter_path, err); !err && it != std::filesystem::recursive_directory_iterator(); it.increment(err)) {
+            struct stat file_stat;
+            if(stat(it->path().c_str(), &file_stat) != 0 || !S_ISREG(file_stat.st_mode))
+                continue;
+            size += file_stat.st_size;
+            last_modified = std::max(last_modified, file_stat.st_mtime);
+        }
+    }
+
+    void MangaCache::create_index_from_files() {
+        // The directories in the cache directory are the manga and the directories in them are the chapters. The names are not split,
+        // since they can be anything (base64 names can contain '/')
+        std::unordered_map<std::string, Manga> files_manga;
+        uint64_t files_total_size = 0;
+        size_t num_chapters = 0;
+        std::error_code err;
+        for(auto manga_it = std::filesystem::directory_iterator(manga_cache_dir.data, err); !err && manga_it != std::filesystem::directory_iterator(); manga_it.increment(err)) {
+            std::error_code file_err;
+            const std::string manga_id = manga_it->path().filename().string();
+            if(!manga_it->is_directory(file_err) || manga_id.compare(0, strlen(EVICTED_DIR_PREFIX), EVICTED_DIR_PREFIX) == 0)
+                continue;
+
+            std::error_code chapter_err;
+            for(auto chapter_it = std::filesystem::directory_iterator(manga_it->path(), chapter_err); !chapter_err && chapter_it != std::filesystem::directory_iterator(); chapter_it.increment(chapter_err)) {
+                if(!chapter_it->is_directory(file_err))
+                    continue;
+
+                Chapter chapter;
+                get_chapter_files_size(chapter_it->path(), chapter.size, chapter.last_access);
+                files_manga[manga_id].chapters[chapter_it->path().filename().string()] = chapter;
+                files_total_size += chapter.size;
+                ++num_chapters;
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        for(auto &manga_it : files_manga) {
+            Manga &manga_item = manga[manga_it.first];
+            for(auto &chapter_it : manga_it.second.chapters) {
+                // Chapters that were opened while the files were walked have newer information
+                auto inserted = manga_item.chapters.insert(chapter_it);
+                if(inserted.second)
+                    total_size += chapter_it.second.size;
+            }
+        }
+        index_dirty = true;
+        fprintf(stderr, "Created the manga cache index, %zu chapters, %llu bytes\n", num_chapters, (unsigned long long)files_total_size);
+    }
+
+    void MangaCache::save_index(std::unique_lock<std::mutex> &lock) {
+        Json::Value json_manga(Json::objectValue);
+        for(auto &manga_it : manga) {
+            if(!manga_it.second.pinned && manga_it.second.chapters.empty())
+                continue;
+
+            Json::Value json_chapters(Json::objectValue);
+            for(auto &chapter_it : manga_it.second.chapters) {
+                Json::Value json_chapter(Json::arrayValue);
+                json_chapter.append((Json::UInt64)chapter_it.second.size);
+                json_chapter.append((Json::Int64)chapter_it.second.last_access);
+                json_chapters[chapter_it.first] = std::move(json_chapter);
+            }
+
+            Json::Value &json_manga_item = json_manga[manga_it.first];
+            if(manga_it.second.pinned)
+                json_manga_item["pinned"] = true;
+            json_manga_item["chapters"] = std::move(json_chapters);
+        }
+        index_dirty = false;
+
+        Json::Value json_root(Json::objectValue);
+        json_root["manga"] = std::move(json_manga);
+        lock.unlock();
+
+        Json::StreamWriterBuilder json_builder;
+        json_builder["indentation"] = "";
+        // Written to another file that replaces the index, so the index is not lost if the program is killed while it's written
+        Path tmp_index_path = index_path;
+        tmp_index_path.data += ".tmp";
+        if(create_directory_recursive(manga_cache_dir) != 0
+            || file_overwrite(tmp_index_path, Json::writeString(json_builder, json_root)) != 0
+            || rename(tmp_index_path.data.c_str(), index_path.data.c_str()) != 0)
+        {
+            fprintf(stderr, "Failed to save the manga cache index to %s\n", index_path.data.c_str());
+        }
+        lock.lock();
+    }
+
+    void MangaCache::evict_chapters(std::unique_lock<std::mutex> &lock) {
+        struct EvictCandidate {
+            time_t last_access;
+            std::string manga_id;
+            std::string chapter_dir;
+        };
+
+        std::vector<EvictCandidate> candidates;
+        for(auto &manga_it : manga) {
+            if(manga_it.second.pinned)
+                continue;
+            for(auto &chapter_it : manga_it.second.chapters) {
+                candidates.push_back({ chapter_it.second.last_access, manga_it.first, chapter_it.first });
+            }
+        }
+        std::sort(candidates.begin(), candidates.end(), [](const EvictCandidate &candidate1, const EvictCandidate &candidate2) {
+            return candidate1.last_access < candidate2.last_access;
+        });
+
+        const uint64_t target_size = max_size * EVICT_TARGET_RATIO;
+        const uint64_t size_before = total_size;
+        int num_evicted = 0;
+        for(const EvictCandidate &candidate : candidates) {
+            if(!running || total_size <= target_size)
+                break;
+
+            // The lock is released while files are removed, so the chapter could have been opened, pinned or used again since the candidates were found
+            auto manga_it = manga.find(candidate.manga_id);
+            if(manga_it == manga.end() || manga_it->second.pinned)
+                continue;
+            auto chapter_it = manga_it->second.chapters.find(candidate.chapter_dir);
+            if(chapter_it == manga_it->second.chapters.end() || chapter_it->second.last_access != candidate.last_access)
+                continue;
+            if(candidate.manga_id == open_manga_id && candidate.chapter_dir == open_chapter_dir)
+                continue;
+
+            total_size -= chapter_it->second.size;
+            manga_it->second.chapters.erase(chapter_it);
+            index_dirty = true;
+            ++num_evicted;
+
+            Path chapter_path = manga_cache_dir;
+            chapter_path.join(candidate.manga_id).join(candidate.chapter_dir);
+            // The chapter is moved while the lock is held, so a chapter that is opened after this creates a new directory
+            Path evicted_path = manga_cache_dir;
+            evicted_path.join(EVICTED_DIR_PREFIX + std::to_string(getpid()) + "-" + std::to_string(num_evicted_dirs++));
+            if(rename(chapter_path.data.c_str(), evicted_path.data.c_str()) != 0)
+                continue;
+
+            lock.unlock();
+            std::error_code err;
+            std::filesystem::remove_all(evicted_path.data, err);
+            // Removes the directory of the manga if this was its last chapter. Fails if it's not empty
+            Path manga_path = manga_cache_dir;
+            manga_path.join(candidate.manga_id);
+            rmdir(manga_path.data.c_str());
+            lock.lock();
+        }
+
+        if(num_evicted > 0)
+            fprintf(stderr, "Removed %d chapters from the manga cache, %llu -> %llu bytes\n", num_evicted, (unsigned long long)size_before, (unsigned long long)total_size);
+    }
+
+    void MangaCache::remove_evicted_dirs() {
+        // Chapters that were being removed when the program was closed
+        std::error_code err;
+        for(auto it = std::filesystem::directory_iterator(manga_cache_dir.data, err); !err && it != std::filesystem::directory_iterator(); it.increment(err)) {
+            if(it->path().filename().string().compare(0, strlen(EVICTED_DIR_PREFIX), EVICTED_DIR_PREFIX) == 0) {
+                std::error_code remove_err;
+                std::filesystem::remove_all(it->path(), remove_err);
+            }
+        }
+    }
+}
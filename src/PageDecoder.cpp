@@ -0,0 +1,348 @@
+#include "../include/PageDecoder.hpp"
+#include "../include/TaskQueue.hpp"
+#include "../include/Storage.hpp"
+#include "../include/Instrumentation.hpp"
+#include "../include/ImageDecoder.hpp"
+#include "../include/ChapterPack.hpp"
+#include <SFML/Graphics/Image.hpp>
+#include <SFML/System/Clock.hpp>
+#include <algorithm>
+
+namespace QuickMedia {
+    static const int NUM_DECODE_THREADS = 2;
+    static const int NUM_PAGES_BEHIND = 1;
+    static const int NUM_PAGES_AHEAD = 3;
+    // Smaller tiles than the maximum texture size, so less of a tall page is uploaded that is not visible
+    static const unsigned int MAX_TILE_HEIGHT = 2048;
+
+    PageDecoder::PageDecoder(TaskQueue &main_thread_tasks) :
+        main_thread_tasks(main_thread_tasks),
+        current_page(0),
+        num_pages(0),
+        upload_decoded_pages(true),
+        tile_height(std::min(sf::Texture::getMaximumSize(), MAX_TILE_HEIGHT)),
+        running(true),
+        chapter_id(0),
+        download_check(0),
+        max_page_size(0, 0)
+    {
+        for(int i = 0; i < NUM_DECODE_THREADS; ++i) {
+            decode_threads.push_back(std::thread(&PageDecoder::decode_thread_func, this));
+        }
+    }
+
+    PageDecoder::~PageDecoder() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            running = false;
+        }
+        queue_cond.notify_all();
+        for(std::thread &decode_thread : decode_threads) {
+            decode_thread.join();
+        }
+    }
+
+    void PageDecoder::set_chapter(const Path &chapter_cache_dir, int num_pages) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if(chapter_cache_dir.data == this->chapter_cache_dir.data && num_pages == this->num_pages)
+                return;
+
+            ++chapter_id;
+            this->chapter_cache_dir = chapter_cache_dir;
+            chapter_pack = std::make_shared<ChapterPack>(chapter_cache_dir);
+            queue.clear();
+            decoding_pages.clear();
+        }
+        pages.clear();
+        page_sizes.clear();
+        this->num_pages = num_pages;
+        current_page = 0;
+    }
+
+    void PageDecoder::set_current_page(int page_index) {
+        set_page_range(page_index, page_index);
+    }
+
+    void PageDecoder::set_page_range(int first_visible_page, int last_visible_page) {
+        current_page = first_visible_page;
+        const int first_page = std::max(0, first_visible_page - NUM_PAGES_BEHIND);
+        const int last_page = std::min(num_pages - 1, last_visible_page + NUM_PAGES_AHEAD);
+
+        for(auto it = pages.begin(); it != pages.end();) {
+            if(it->first < first_page || it->first > last_page)
+                it = pages.erase(it);
+            else
+                ++it;
+        }
+
+        for(int i = first_page; i <= last_page; ++i) {
+            // Intentionally creates the page with the state PageState::DECODING if it doesn't exist
+            pages[i];
+        }
+        queue_pages();
+    }
+
+    void PageDecoder::check_downloaded_pages() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            ++download_check;
+        }
+
+        bool page_downloaded = false;
+        for(auto &it : pages) {
+            if(it.second.state == PageState::DOWNLOADING) {
+                it.second.state = PageState::DECODING;
+                page_downloaded = true;
+            } else if(it.second.state == PageState::PARTIAL) {
+                it.second.outdated = true;
+                page_downloaded = true;
+            }
+        }
+
+        if(page_downloaded)
+            queue_pages();
+    }
+
+    const DecodedPage* PageDecoder::get_page(int page_index) const {
+        auto it = pages.find(page_index);
+        if(it == pages.end())
+            return nullptr;
+        return &it->second;
+    }
+
+    bool PageDecoder::get_page_size(int page_index, sf::Vector2u &size) const {
+        auto it = page_sizes.find(page_index);
+        if(it == page_sizes.end())
+            return false;
+        size = it->second;
+        return true;
+    }
+
+    void PageDecoder::set_max_page_size(sf::Vector2u max_size) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if(max_size == max_page_size)
+                return;
+            max_page_size = max_size;
+        }
+
+        // Pages are not decoded again when the max size decreases, they are scaled down when they are drawn instead
+        bool page_outdated = false;
+        for(auto &it : pages) {
+            DecodedPage &page = it.second;
+            if(page.state != PageState::LOADED || page.outdated)
+                continue;
+
+            const sf::Vector2u image_size = page.image->getSize();
+            const float needed_width = page.size.x * get_image_fit_scale(page.size, max_size);
+            if(image_size.x < page.size.x && image_size.x + 1 < needed_width) {
+                page.outdated = true;
+                page_outdated = true;
+            }
+        }
+
+        if(page_outdated)
+            queue_pages();
+    }
+
+    void PageDecoder::set_upload_decoded_pages(bool upload) {
+        upload_decoded_pages = upload;
+    }
+
+    void PageDecoder::update_tiles(int page_index, unsigned int top, unsigned int bottom) {
+        auto it = pages.find(page_index);
+        if(it == pages.end() || !it->second.has_image())
+            return;
+
+        DecodedPage &page = it->second;
+        const sf::Vector2u image_size = page.image->getSize();
+        for(size_t i = 0; i < page.tiles.size(); ++i) {
+            const unsigned int tile_top = i * tile_height;
+            const unsigned int tile_bottom = std::min(image_size.y, tile_top + tile_height);
+            if(tile_bottom <= top || tile_top >= bottom) {
+                page.tiles[i].reset();
+                continue;
+            }
+
+            if(page.tiles[i])
+                continue;
+
+            sf::Clock upload_timer;
+            auto tile = std::make_unique<sf::Texture>();
+            if(!tile->create(image_size.x, tile_bottom - tile_top)) {
+                fprintf(stderr, "Failed to create texture for page %d\n", page_index + 1);
+                page.state = PageState::FAILED;
+                page.outdated = false;
+                page.image.reset();
+                page.tiles.clear();
+                return;
+            }
+            tile->update(page.image->getPixelsPtr() + (size_t)tile_top * image_size.x * 4, image_size.x, tile_bottom - tile_top, 0, 0);
+            tile->setSmooth(true);
+            page.tiles[i] = std::move(tile);
+            instrumentation_record("tile upload", upload_timer.getElapsedTime().asMicroseconds() * 0.001);
+        }
+    }
+
+    void PageDecoder::free_tiles_outside(int first_page, int last_page) {
+        for(auto &it : pages) {
+            if(it.first >= first_page && it.first <= last_page)
+                continue;
+            for(auto &tile : it.second.tiles) {
+                tile.reset();
+            }
+        }
+    }
+
+    void PageDecoder::queue_pages() {
+        // The current page first, then the pages after it before the pages before it, since pages are usually read forward
+        std::vector<int> page_order;
+        for(auto &it : pages) {
+            if(it.second.state == PageState::DECODING || it.second.outdated)
+                page_order.push_back(it.first);
+        }
+        const int page_index = current_page;
+        std::stable_sort(page_order.begin(), page_order.end(), [page_index](int page1, int page2) {
+            int distance1 = page1 >= page_index ? page1 - page_index : (page_index - page1) * 2;
+            int distance2 = page2 >= page_index ? page2 - page_index : (page_index - page2) * 2;
+            return distance1 < distance2;
+        });
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            queue.clear();
+            for(int page : page_order) {
+                if(decoding_pages.find(page) == decoding_pages.end())
+                    queue.push_back(page);
+            }
+        }
+        queue_cond.notify_all();
+    }
+
+    void PageDecoder::decode_thread_func() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while(true) {
+            queue_cond.wait(lock, [this]() { return !running || !queue.empty(); });
+            if(!running)
+                break;
+
+            const int page_index = queue.front();
+            queue.pop_front();
+            decoding_pages.insert(page_index);
+            const int decode_chapter_id = chapter_id;
+            const int decode_download_check = download_check;
+            const sf::Vector2u max_size = max_page_size;
+            std::shared_ptr<ChapterPack> pack = chapter_pack;
+            Path image_path = chapter_cache_dir;
+            image_path.join(std::to_string(page_index + 1));
+            lock.unlock();
+
+            sf::Clock decode_timer;
+            PageState state = PageState::FAILED;
+            auto image = std::make_shared<sf::Image>();
+            sf::Vector2u image_file_size;
+            PackedPage packed_page;
+            std::string image_data;
+            // Downloaded pages are in the chapter pack. The page is downloaded to a part file that is renamed to the page file when it's complete,
+            // and then moved to the pack
+            Path image_part_path(image_path.data + ".part");
+            if(pack->get_page(page_index, packed_page)) {
+                if(decode_image_scaled(packed_page.data, packed_page.size, max_size, *image, image_file_size))
+                    state = PageState::LOADED;
+            } else if(get_file_type(image_path) == FileType::REGULAR) {
+                if(file_get_content(image_path, image_data) == 0 && decode_image_scaled(image_data.data(), image_data.size(), max_size, *image, image_file_size))
+                    state = PageState::LOADED;
+            } else {
+                // Shows what has been downloaded so far
+                state = PageState::DOWNLOADING;
+                if(get_file_type(image_part_path) == FileType::REGULAR && file_get_content(image_part_path, image_data) == 0 && decode_partial_image_scaled(image_data.data(), image_data.size(), max_size, *image, image_file_size)) {
+                    state = PageState::PARTIAL;
+                    instrumentation_record("partial page decode", decode_timer.getElapsedTime().asMicroseconds() * 0.001);
+                }
+            }
+
+            if(state == PageState::LOADED)
+                instrumentation_record("page decode", decode_timer.getElapsedTime().asMicroseconds() * 0.001);
+            else if(state == PageState::FAILED)
+                fprintf(stderr, "Failed to load image for page %d: %s\n", page_index + 1, image_path.data.c_str());
+
+            if(state != PageState::LOADED && state != PageState::PARTIAL)
+                image.reset();
+
+            // The page is not decoding anymore when the main thread gets the result, so it can be queued again by the main thread
+            lock.lock();
+            if(decode_chapter_id == chapter_id)
+                decoding_pages.erase(page_index);
+            main_thread_tasks.post([this, decode_chapter_id, decode_download_check, page_index, state, image, image_file_size]() {
+                on_page_decoded(decode_chapter_id, decode_download_check, page_index, state, image, image_file_size);
+            });
+        }
+    }
+
+    void PageDecoder::on_page_decoded(int decode_chapter_id, int decode_download_check, int page_index, PageState state, std::shared_ptr<sf::Image> image, sf::Vector2u image_file_size) {
+        bool downloaded_since_decode;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if(decode_chapter_id != chapter_id)
+                return;
+            downloaded_since_decode = decode_download_check != download_check;
+        }
+
+        // The page is no longer in the ring if the user has turned many pages while it was decoding
+        auto it = pages.find(page_index);
+        if(it == pages.end() || (it->second.state != PageState::DECODING && !it->second.outdated))
+            return;
+
+        DecodedPage &page = it->second;
+        // More of the page has been downloaded since it was decoded, so it's decoded again
+        const bool decode_again = (state == PageState::DOWNLOADING || state == PageState::PARTIAL) && downloaded_since_decode;
+
+        // The page keeps the image it has if it fails to decode again
+        if(page.has_image() && state != PageState::LOADED && state != PageState::PARTIAL) {
+            page.outdated = decode_again;
+            if(decode_again)
+                queue_pages();
+            return;
+        }
+
+        if(state == PageState::DOWNLOADING && decode_again) {
+            queue_pages();
+            return;
+        }
+
+        page.state = state;
+        page.outdated = false;
+        if(state != PageState::LOADED && state != PageState::PARTIAL) {
+            page.image.reset();
+            page.tiles.clear();
+            return;
+        }
+
+        const sf::Vector2u image_size = image->getSize();
+        if(image_size.x == 0 || image_size.y == 0 || image_size.x > sf::Texture::getMaximumSize()) {
+            fprintf(stderr, "Page %d has an unsupported size: %ux%u\n", page_index + 1, image_size.x, image_size.y);
+            page.state = PageState::FAILED;
+            page.image.reset();
+            page.tiles.clear();
+            return;
+        }
+
+        page.size = image_file_size;
+        page.image = std::move(image);
+        page.tiles.clear();
+        page.tiles.resize((image_size.y + tile_height - 1) / tile_height);
+        page_sizes[page_index] = image_file_size;
+
+        if(decode_again) {
+            page.outdated = true;
+            queue_pages();
+        }
+
+        if(upload_decoded_pages) {
+            sf::Clock upload_timer;
+            update_tiles(page_index, 0, image_size.y);
+            instrumentation_record("page upload", upload_timer.getElapsedTime().asMicroseconds() * 0.001);
+        }
+    }
+}
@@ -1,6 +1,8 @@
 #include "../include/Program.h"
 #include <unistd.h>
 #include <sys/wait.h>
+#include <poll.h>
+#include <signal.h>
 #include <errno.h>
 #include <string.h>
 #include <stdio.h>
@@ -10,6 +12,10 @@
 #define WRITE_END 1
 
 int exec_program(const char **args, ProgramOutputCallback output_callback, void *userdata) {
+    return exec_program_cancellable(args, output_callback, NULL, 0, userdata);
+}
+
+int exec_program_cancellable(const char **args, ProgramOutputCallback output_callback, ProgramIdleCallback idle_callback, int idle_interval_ms, void *userdata) {
     /* 1 arguments */
     if(args[0] == NULL)
         return -1;
@@ -40,19 +46,41 @@ int exec_program(const char **args, ProgramOutputCallback output_callback, void
         char buffer[2048];
 
         for(;;) {
+            if(idle_callback) {
+                struct pollfd poll_fd = { fd[READ_END], POLLIN, 0 };
+                int poll_result = poll(&poll_fd, 1, idle_interval_ms);
+                if(poll_result == -1 && errno == EINTR)
+                    continue;
+                if(poll_result == 0) {
+                    if(idle_callback(userdata) != 0) {
+                        kill(pid, SIGTERM);
+                        close(fd[READ_END]);
+                        fd[READ_END] = -1;
+                        break;
+                    }
+                    continue;
+                }
+            }
+
             ssize_t bytes_read = read(fd[READ_END], buffer, sizeof(buffer) - 1);
             if(bytes_read == 0) {
                 break;
             } else if(bytes_read == -1) {
                 int err = errno;
+                if(err == EINTR)
+                    continue;
                 fprintf(stderr, "Failed to read from pipe to program %s, error: %s\n", args[0], strerror(err));
                 result = -err;
                 goto cleanup;
             }
 
             buffer[bytes_read] = '\0';
-            if(output_callback && output_callback(buffer, bytes_read, userdata) != 0)
+            if(output_callback && output_callback(buffer, bytes_read, userdata) != 0) {
+                /* The program gets SIGPIPE when it writes more output, instead of blocking forever on a full pipe while it's waited for */
+                close(fd[READ_END]);
+                fd[READ_END] = -1;
                 break;
+            }
         }
 
         if(waitpid(pid, &status, 0) == -1) {
@@ -82,7 +110,8 @@ int exec_program(const char **args, ProgramOutputCallback output_callback, void
         }
 
         cleanup:
-        close(fd[READ_END]);
+        if(fd[READ_END] != -1)
+            close(fd[READ_END]);
         return result;
     }
 }
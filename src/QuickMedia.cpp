@@ -6,8 +6,15 @@
 #include "../include/Scale.hpp"
 #include "../include/Program.h"
 #include "../include/VideoPlayer.hpp"
+#include "../include/StreamResolver.hpp"
 #include "../include/StringUtils.hpp"
 #include "../include/GoogleCaptcha.hpp"
+#include "../include/PageDecoder.hpp"
+#include "../include/ImageDecoder.hpp"
+#include "../include/ChapterPack.hpp"
+#include "../include/MangaCache.hpp"
+#include "../include/SeriesDownloader.hpp"
+#include "../include/Instrumentation.hpp"
 #include <cppcodec/base64_rfc4648.hpp>
 
 #include <SFML/Graphics/RectangleShape.hpp>
@@ -18,13 +25,22 @@
 #include <json/writer.h>
 #include <assert.h>
 #include <cmath>
+#include <algorithm>
 #include <string.h>
+#include <limits.h>
 #include <X11/Xlib.h>
 #include <X11/Xatom.h>
 #include <signal.h>
+#include <poll.h>
 
 static const sf::Color back_color(30, 32, 34);
 static const int DOUBLE_CLICK_TIME = 500;
+// Events that only SFML receives (such as closing the window) are handled within this time
+static const int MAX_EVENT_WAIT_MS = 1000;
+// How often pages that are downloading are decoded again to show more of them
+static const int PAGE_DOWNLOAD_PROGRESS_INTERVAL_MS = 250;
+// Used if the size of the manga cache is not set with --manga-cache-size
+static const uint64_t DEFAULT_MANGA_CACHE_SIZE_MB = 2048;
 static const std::string fourchan_google_captcha_api_key = "6Ldp2bsSAAAAAAJ5uyx_lx34lJeEpTLVkP5k04qc";
 
 // Prevent writing to broken pipe from exiting the program
@@ -44,6 +60,7 @@ namespace QuickMedia {
     Program::Program() :
         window(sf::VideoMode(800, 600), "QuickMedia"),
         window_size(800, 600),
+        event_display(nullptr),
         body(nullptr),
         current_plugin(nullptr),
         current_page(Page::SEARCH_SUGGESTION),
@@ -68,11 +85,81 @@ namespace QuickMedia {
 
         XSetErrorHandler(x_error_handler);
         XSetIOErrorHandler(x_io_error_handler);
+
+        event_display = XOpenDisplay(NULL);
+        if(!event_display)
+            throw std::runtime_error("Failed to open display to X11 server");
+        // ButtonPress can only be selected by one client (SFML), so button releases are used to wake up instead
+        XSelectInput(event_display, window.getSystemHandle(), KeyPressMask | KeyReleaseMask | ButtonReleaseMask | PointerMotionMask | StructureNotifyMask | FocusChangeMask | ExposureMask);
+        XFlush(event_display);
     }
 
     Program::~Program() {
+        video_player.reset();
+        stream_resolver.reset();
+        page_decoder.reset();
+        if(image_download_future.valid()) {
+            image_download_cancel = true;
+            image_download_future.get();
+        }
+        // Waits for the related media that is being fetched, since it uses the plugin
+        related_media_future = std::future<BodyItems>();
+        abandoned_related_media_futures.clear();
+        series_downloader.reset();
+        manga_cache.reset();
         delete body;
         delete current_plugin;
+        if(event_display)
+            XCloseDisplay(event_display);
+    }
+
+    // -1 is no timeout
+    static int min_timeout(int timeout_ms, int other_timeout_ms) {
+        if(timeout_ms == -1)
+            return other_timeout_ms;
+        if(other_timeout_ms == -1)
+            return timeout_ms;
+        return std::min(timeout_ms, other_timeout_ms);
+    }
+
+    bool Program::wait_for_events(int timeout_ms, std::initializer_list<int> fds) {
+        timeout_ms = min_timeout(timeout_ms, MAX_EVENT_WAIT_MS);
+        // SFML receives its copy of the events on another connection, it might not have received them yet when they were received here.
+        // The window is checked again shortly after, so the events are not handled late
+        if(window_event_timer.getElapsedTime().asMilliseconds() < 50)
+            timeout_ms = std::min(timeout_ms, 10);
+
+        if(XPending(event_display) == 0) {
+            std::vector<struct pollfd> poll_fds;
+            poll_fds.push_back({ ConnectionNumber(event_display), POLLIN, 0 });
+            poll_fds.push_back({ main_thread_tasks.get_fd(), POLLIN, 0 });
+            for(int fd : fds) {
+                poll_fds.push_back({ fd, POLLIN, 0 });
+            }
+            poll(poll_fds.data(), poll_fds.size(), timeout_ms);
+        }
+
+        bool redraw = false;
+        XEvent xev;
+        while(XPending(event_display) > 0) {
+            XNextEvent(event_display, &xev);
+            window_event_timer.restart();
+            if(xev.type == Expose || xev.type == MapNotify)
+                redraw = true;
+        }
+
+        if(main_thread_tasks.run_tasks() > 0)
+            redraw = true;
+        return redraw;
+    }
+
+    bool Program::wait_for_body_page_events(Body *page_body, int timeout_ms) {
+        if(page_body->has_new_thumbnail())
+            return true;
+
+        timeout_ms = min_timeout(timeout_ms, search_bar->get_update_timeout_ms());
+        bool redraw = wait_for_events(timeout_ms);
+        return redraw || page_body->has_new_thumbnail();
     }
 
     static SearchResult search_selected_suggestion(Body *input_body, Body *output_body, Plugin *plugin, std::string &selected_title, std::string &selected_url) {
@@ -89,10 +176,14 @@ namespace QuickMedia {
     }
 
     static void usage() {
-        fprintf(stderr, "usage: QuickMedia <plugin> [--tor]\n");
+        fprintf(stderr, "usage: QuickMedia <plugin> [--tor] [--manga-cache-size <megabytes>] [--manga-download-rate <kilobytes>]\n");
         fprintf(stderr, "OPTIONS:\n");
-        fprintf(stderr, "plugin    The plugin to use. Should be either 4chan, manganelo, pornhub or youtube\n");
-        fprintf(stderr, "--tor     Use tor. Disabled by default\n");
+        fprintf(stderr, "plugin                 The plugin to use. Should be either 4chan, manganelo, pornhub or youtube\n");
+        fprintf(stderr, "--tor                  Use tor. Disabled by default\n");
+        fprintf(stderr, "--manga-cache-size     The size that downloaded manga chapters can use on disk. The least recently read chapters are removed\n");
+        fprintf(stderr, "                       when it's full. 0 is unlimited. %llu megabytes by default\n", (unsigned long long)DEFAULT_MANGA_CACHE_SIZE_MB);
+        fprintf(stderr, "--manga-download-rate  The number of kilobytes per second that downloads of whole manga (Ctrl + D) can use together.\n");
+        fprintf(stderr, "                       0 is unlimited, which is the default\n");
         fprintf(stderr, "EXAMPLES:\n");
         fprintf(stderr, "QuickMedia manganelo\n");
         fprintf(stderr, "QuickMedia youtube --tor\n");
@@ -126,6 +217,8 @@ namespace QuickMedia {
         current_plugin = nullptr;
         std::string plugin_logo_path;
         bool use_tor = false;
+        uint64_t manga_cache_size_mb = DEFAULT_MANGA_CACHE_SIZE_MB;
+        int manga_download_rate_kb = 0;
 
         for(int i = 1; i < argc; ++i) {
             if(!current_plugin) {
@@ -146,6 +239,26 @@ namespace QuickMedia {
 
             if(strcmp(argv[i], "--tor") == 0) {
                 use_tor = true;
+            } else if(strcmp(argv[i], "--manga-cache-size") == 0) {
+                char *size_end = nullptr;
+                if(i + 1 < argc)
+                    manga_cache_size_mb = strtoull(argv[i + 1], &size_end, 10);
+                if(!size_end || size_end == argv[i + 1] || *size_end != '\0') {
+                    fprintf(stderr, "Expected the size in megabytes after --manga-cache-size\n");
+                    usage();
+                    return -1;
+                }
+                ++i;
+            } else if(strcmp(argv[i], "--manga-download-rate") == 0) {
+                char *rate_end = nullptr;
+                if(i + 1 < argc)
+                    manga_download_rate_kb = strtol(argv[i + 1], &rate_end, 10);
+                if(!rate_end || rate_end == argv[i + 1] || *rate_end != '\0' || manga_download_rate_kb < 0) {
+                    fprintf(stderr, "Expected the number of kilobytes per second after --manga-download-rate\n");
+                    usage();
+                    return -1;
+                }
+                ++i;
             }
         }
 
@@ -161,6 +274,14 @@ namespace QuickMedia {
 
         current_plugin->use_tor = use_tor;
 
+        if(current_plugin->name == "manganelo") {
+            manga_cache = std::make_unique<MangaCache>(get_cache_dir().join("manga"), manga_cache_size_mb * 1024 * 1024);
+            // Continues the downloads of manga that were queued before the program was closed
+            series_downloader = std::make_unique<SeriesDownloader>(static_cast<Manganelo*>(current_plugin), manga_cache.get(), manga_download_rate_kb * 1024, [this]() {
+                main_thread_tasks.post(nullptr);
+            });
+        }
+
         if(!plugin_logo_path.empty()) {
             if(!plugin_logo.loadFromFile(plugin_logo_path)) {
                 fprintf(stderr, "Failed to load plugin logo, path: %s\n", plugin_logo_path.c_str());
@@ -173,6 +294,16 @@ namespace QuickMedia {
         search_bar = std::make_unique<SearchBar>(font, plugin_logo);
         search_bar->text_autosearch_delay = current_plugin->get_search_delay();
 
+        // Start mpv while the user is searching, so the first video starts faster
+        if(current_plugin->get_page_after_search() == Page::VIDEO_CONTENT) {
+            video_player = std::make_unique<VideoPlayer>(current_plugin->use_tor, nullptr, nullptr);
+            if(video_player->start(window.getSystemHandle()) != VideoPlayer::Error::OK)
+                video_player.reset();
+        }
+
+        if(current_plugin->can_resolve_video_streams())
+            stream_resolver = std::make_unique<StreamResolver>(use_tor, [this]() { main_thread_tasks.post(nullptr); });
+
         while(window.isOpen()) {
             switch(current_page) {
                 case Page::EXIT:
@@ -199,9 +330,14 @@ namespace QuickMedia {
                 case Page::IMAGES: {
                     body->draw_thumbnails = false;
                     window.setKeyRepeatEnabled(false);
-                    window.setFramerateLimit(4);
                     image_page();
-                    window.setFramerateLimit(0);
+                    window.setKeyRepeatEnabled(true);
+                    break;
+                }
+                case Page::IMAGES_CONTINUOUS: {
+                    body->draw_thumbnails = false;
+                    window.setKeyRepeatEnabled(false);
+                    image_continuous_page();
                     window.setKeyRepeatEnabled(true);
                     break;
                 }
@@ -232,6 +368,7 @@ namespace QuickMedia {
             }
         }
 
+        instrumentation_dump(stderr);
         return 0;
     }
 
@@ -458,6 +595,8 @@ namespace QuickMedia {
         sf::Vector2f body_pos;
         sf::Vector2f body_size;
         bool redraw = true;
+        // The page is only drawn when something has changed
+        bool dirty = true;
         sf::Event event;
         
         const sf::Color tab_selected_color(0, 85, 119);
@@ -472,6 +611,7 @@ namespace QuickMedia {
         while (current_page == Page::SEARCH_SUGGESTION) {
             while (window.pollEvent(event)) {
                 base_event_handler(event, Page::EXIT, false);
+                dirty = true;
                 if(event.type == sf::Event::Resized || event.type == sf::Event::GainedFocus)
                     redraw = true;
                 else if(event.type == sf::Event::KeyPressed) {
@@ -508,12 +648,14 @@ namespace QuickMedia {
                 body_size = sf::Vector2f(body_width, window_size.y - search_bottom - body_padding_vertical);
             }
 
-            search_bar->update();
+            if(search_bar->update())
+                dirty = true;
 
             if(!update_search_text.empty() && !search_running) {
                 search_suggestion_future = std::async(std::launch::async, [this, update_search_text]() {
                     BodyItems result;
                     SuggestionResult suggestion_result = current_plugin->update_search_suggestions(update_search_text, result);
+                    main_thread_tasks.post(nullptr);
                     return result;
                 });
                 update_search_text.clear();
@@ -524,12 +666,32 @@ namespace QuickMedia {
                 if(update_search_text.empty()) {
                     body->items = search_suggestion_future.get();
                     body->clamp_selection();
+                    dirty = true;
                 } else {
                     search_suggestion_future.get();
                 }
                 search_running = false;
             }
 
+            // The stream of the highlighted video is resolved while the user decides, so the video starts right away when it's selected
+            if(stream_resolver) {
+                BodyItem *selected_item = tabs[selected_tab].body->get_selected();
+                if(selected_item && !selected_item->url.empty() && selected_item->url != last_resolve_request_url) {
+                    last_resolve_request_url = selected_item->url;
+                    stream_resolver->request(last_resolve_request_url);
+                }
+            }
+
+            if(current_page != Page::SEARCH_SUGGESTION)
+                break;
+
+            if(!dirty) {
+                if(wait_for_body_page_events(tabs[selected_tab].body))
+                    dirty = true;
+                continue;
+            }
+            dirty = false;
+
             window.clear(back_color);
             {
                 tab_spacing_rect.setPosition(0.0f, search_bar->getBottomWithoutShadow());
@@ -677,8 +839,9 @@ namespace QuickMedia {
             throw std::runtime_error("Failed to open display to X11 server");
         XDisplayScope display_scope(disp);
 
+        bool ui_resize = true;
         std::unique_ptr<sf::RenderWindow> video_player_ui_window;
-        auto on_window_create = [disp, &video_player_ui_window](sf::WindowHandle video_player_window) {
+        auto on_window_create = [this, disp, &video_player_ui_window, &ui_resize](sf::WindowHandle video_player_window) {
             int screen = DefaultScreen(disp);
             Window ui_window = XCreateWindow(disp, RootWindow(disp, screen),
                             0, 0, 1, 1, 0,
@@ -691,59 +854,119 @@ namespace QuickMedia {
             XMapWindow(disp, ui_window);
             XFlush(disp);
 
+            // So |wait_for_events| wakes up for seeking
+            XSelectInput(event_display, ui_window, ButtonReleaseMask | PointerMotionMask);
+            XFlush(event_display);
+
             video_player_ui_window = std::make_unique<sf::RenderWindow>(ui_window);
             video_player_ui_window->setVerticalSyncEnabled(true);
+            ui_resize = true;
         };
 
-        bool ui_resize = true;
-        bool seekable = false;
+        // The video that will be played after the current video, and the path it was added to the mpv playlist with
+        std::string next_video_url;
+        std::string next_video_path;
+        // The video ended before the related media was fetched, the next video is played when it has been fetched
+        bool play_next_video_when_fetched = false;
+
+        // Find video that hasn't been played before in this video session
+        auto find_unwatched_video_url = [this](const BodyItems &related_media) -> std::string {
+            for(auto it = related_media.begin(), end = related_media.end(); it != end; ++it) {
+                if(watched_videos.find((*it)->url) == watched_videos.end())
+                    return (*it)->url;
+            }
+            return "";
+        };
+
+        // The related media that is being fetched for another video is not waited for, it's kept until it's ready
+        auto abandon_related_media_future = [this]() {
+            abandoned_related_media_futures.erase(std::remove_if(abandoned_related_media_futures.begin(), abandoned_related_media_futures.end(), [](std::future<BodyItems> &future) {
+                return future.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+            }), abandoned_related_media_futures.end());
+            if(related_media_future.valid() && related_media_future.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+                abandoned_related_media_futures.push_back(std::move(related_media_future));
+            related_media_future = std::future<BodyItems>();
+        };
+        // The related media of the video that was played on the previous video page
+        abandon_related_media_future();
+
+        // Related media is fetched while the video is playing, so the next video can be added to mpv's playlist before the current video ends
+        auto fetch_related_media = [this, &next_video_url, &next_video_path, &abandon_related_media_future]() {
+            next_video_url.clear();
+            next_video_path.clear();
+            abandon_related_media_future();
+            Plugin *plugin = current_plugin;
+            std::string url = content_url;
+            related_media_future = std::async(std::launch::async, [this, plugin, url]() {
+                BodyItems related_media = plugin->get_related_media(url);
+                main_thread_tasks.post(nullptr);
+                return related_media;
+            });
+        };
 
-        std::unique_ptr<VideoPlayer> video_player;
+        auto get_resolved_stream = [this](const std::string &url, ResolvedStream &resolved_stream) {
+            return stream_resolver && stream_resolver->get(url, resolved_stream) == StreamResolveResult::OK;
+        };
 
-        auto load_video_error_check = [this, &video_player, previous_page]() {
+        auto load_video_error_check = [this, &fetch_related_media, &get_resolved_stream, previous_page]() {
             watched_videos.insert(content_url);
-            VideoPlayer::Error err = video_player->load_video(content_url.c_str(), window.getSystemHandle());
+            VideoPlayer::Error err;
+            ResolvedStream resolved_stream;
+            if(get_resolved_stream(content_url, resolved_stream))
+                err = video_player->load_video(resolved_stream.video_url.c_str(), window.getSystemHandle(), resolved_stream.audio_url.empty() ? nullptr : resolved_stream.audio_url.c_str());
+            else
+                err = video_player->load_video(content_url.c_str(), window.getSystemHandle());
+
             if(err != VideoPlayer::Error::OK) {
                 std::string err_msg = "Failed to play url: ";
                 err_msg += content_url;
                 show_notification("Video player", err_msg.c_str(), Urgency::CRITICAL);
                 current_page = previous_page;
+                return;
             }
+            fetch_related_media();
         };
-        
-        video_player = std::make_unique<VideoPlayer>(current_plugin->use_tor, [this, &video_player, &seekable, &load_video_error_check, previous_page](const char *event_name) {
-            bool end_of_file = false;
-            if(strcmp(event_name, "pause") == 0) {
-                double time_remaining = 0.0;
-                if(video_player->get_time_remaining(&time_remaining) == VideoPlayer::Error::OK && time_remaining <= 1.0)
-                    end_of_file = true;
-            } else if(strcmp(event_name, "playback-restart") == 0) {
-                video_player->set_paused(false);
-                video_player->is_seekable(&seekable);
+
+        // Used when the video ended before the next video could be added to the playlist
+        auto play_next_related_video = [this, &next_video_url, &play_next_video_when_fetched, &load_video_error_check, previous_page]() {
+            // The ui is not blocked while the related media is fetched, the video is played from the update loop when it has been fetched
+            if(next_video_url.empty() && related_media_future.valid()) {
+                play_next_video_when_fetched = true;
+                return;
             }
+            play_next_video_when_fetched = false;
+            std::string new_video_url = next_video_url;
 
-            if(end_of_file) {
-                std::string new_video_url;
-                BodyItems related_media = current_plugin->get_related_media(content_url);
-                // Find video that hasn't been played before in this video session
-                for(auto it = related_media.begin(), end = related_media.end(); it != end; ++it) {
-                    if(watched_videos.find((*it)->url) == watched_videos.end()) {
-                        new_video_url = (*it)->url;
-                        break;
-                    }
-                }
+            // If there are no videos to play, then dont play any...
+            if(new_video_url.empty()) {
+                show_notification("Video player", "No more related videos to play");
+                current_page = previous_page;
+                return;
+            }
 
-                // If there are no videos to play, then dont play any...
-                if(new_video_url.empty()) {
-                    show_notification("Video player", "No more related videos to play");
-                    current_page = previous_page;
-                    return;
-                }
+            content_url = std::move(new_video_url);
+            load_video_error_check();
+        };
 
-                content_url = std::move(new_video_url);
-                load_video_error_check();
+        if(!video_player)
+            video_player = std::make_unique<VideoPlayer>(current_plugin->use_tor, nullptr, nullptr);
+
+        video_player->set_window_create_callback(on_window_create);
+        video_player->set_event_callback([this, &next_video_url, &next_video_path, &fetch_related_media, &play_next_related_video](const char *event_name) {
+            if(strcmp(event_name, "eof-reached") == 0) {
+                if(next_video_path.empty())
+                    play_next_related_video();
+            } else if(strcmp(event_name, "path-changed") == 0) {
+                // mpv has moved on to the video that was added to the playlist
+                if(!next_video_path.empty() && video_player->get_playback_state().path == next_video_path) {
+                    content_url = std::move(next_video_url);
+                    watched_videos.insert(content_url);
+                    fetch_related_media();
+                }
+            } else if(strcmp(event_name, "playback-restart") == 0) {
+                video_player->set_paused(false);
             }
-        }, on_window_create);
+        });
         load_video_error_check();
 
         auto on_doubleclick = [this, disp]() {
@@ -760,8 +983,15 @@ namespace QuickMedia {
 
         sf::RectangleShape rect;
         rect.setFillColor(sf::Color::Red);
-        sf::Clock get_progress_timer;
-        double progress = 0.0;
+        // Width of the progress bar that is on the ui window, the ui is only redrawn when it changes
+        int drawn_progress_width = -1;
+
+        auto seek_to_mouse_x = [this](int mouse_x) {
+            if(video_player->get_playback_state().seekable)
+                video_player->set_progress((double)mouse_x / (double)window_size.x);
+            else
+                fprintf(stderr, "Video is not seekable!\n"); // TODO: Show this to the user
+        };
 
         // Clear screen before playing video, to show a black screen instead of being frozen
         // at the previous UI for a moment
@@ -789,8 +1019,9 @@ namespace QuickMedia {
                     }
                 } else if(event.type == sf::Event::MouseMoved) {
                     ui_hide_timer.restart();
-                    if(!ui_visible) {
+                    if(!ui_visible && video_player_ui_window) {
                         ui_visible = true;
+                        ui_resize = true;
                         video_player_ui_window->setVisible(true);
                         //window.setMouseCursorVisible(true);
                     }
@@ -802,6 +1033,15 @@ namespace QuickMedia {
                     if(event.type == sf::Event::Resized) {
                         sf::FloatRect visible_area(0, 0, event.size.width, event.size.height);
                         video_player_ui_window->setView(sf::View(visible_area));
+                        ui_resize = true;
+                    } else if(event.type == sf::Event::MouseMoved) {
+                        ui_hide_timer.restart();
+                        // Dragging the progress bar
+                        if(sf::Mouse::isButtonPressed(sf::Mouse::Left))
+                            seek_to_mouse_x(event.mouseMove.x);
+                    } else if(event.type == sf::Event::MouseButtonPressed && event.mouseButton.button == sf::Mouse::Left) {
+                        ui_hide_timer.restart();
+                        seek_to_mouse_x(event.mouseButton.x);
                     }
                 }
             }
@@ -810,10 +1050,18 @@ namespace QuickMedia {
             if(update_err == VideoPlayer::Error::FAIL_TO_CONNECT_TIMEOUT) {
                 show_notification("Video player", "Failed to connect to mpv ipc after 5 seconds", Urgency::CRITICAL);
                 current_page = previous_page;
+                // mpv is launched again for the next video
+                video_player.reset();
+                return;
+            } else if(update_err == VideoPlayer::Error::DISCONNECTED) {
+                show_notification("Video player", "mpv exited unexpectedly", Urgency::CRITICAL);
+                current_page = previous_page;
+                video_player.reset();
                 return;
             } else if(update_err != VideoPlayer::Error::OK) {
                 show_notification("Video player", "Unexpected error while updating", Urgency::CRITICAL);
                 current_page = previous_page;
+                video_player.reset();
                 return;
             }
 
@@ -821,50 +1069,69 @@ namespace QuickMedia {
             //window.clear();
             //window.display();
 
-            if(video_player->is_connected() && get_progress_timer.getElapsedTime().asMilliseconds() >= 500) {
-                get_progress_timer.restart();
-                video_player->get_progress(&progress);
+            if(related_media_future.valid() && related_media_future.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+                next_video_url = find_unwatched_video_url(related_media_future.get());
+                if(play_next_video_when_fetched)
+                    play_next_related_video();
+                else if(!next_video_url.empty() && stream_resolver)
+                    stream_resolver->request(next_video_url);
             }
 
-            if(video_player_ui_window) {
-                if(!ui_visible) {
-                    std::this_thread::sleep_for(std::chrono::milliseconds(50));
-                    continue;
+            // The next video is added to the playlist once its stream has been resolved, or right away if it can't be resolved
+            if(video_player->is_connected() && !next_video_url.empty() && next_video_path.empty()) {
+                ResolvedStream resolved_stream;
+                StreamResolveResult resolve_result = stream_resolver ? stream_resolver->get(next_video_url, resolved_stream) : StreamResolveResult::ERR;
+                if(resolve_result == StreamResolveResult::OK) {
+                    if(video_player->append_video(resolved_stream.video_url.c_str(), resolved_stream.audio_url.empty() ? nullptr : resolved_stream.audio_url.c_str()) == VideoPlayer::Error::OK)
+                        next_video_path = resolved_stream.video_url;
+                } else if(resolve_result == StreamResolveResult::ERR) {
+                    if(video_player->append_video(next_video_url.c_str()) == VideoPlayer::Error::OK)
+                        next_video_path = next_video_url;
                 }
+            }
 
-                if(ui_hide_timer.getElapsedTime().asMilliseconds() > UI_HIDE_TIMEOUT) {
-                    ui_visible = false;
-                    video_player_ui_window->setVisible(false);
-                    //window.setMouseCursorVisible(false);
-                }
+            if(video_player_ui_window && ui_visible && ui_hide_timer.getElapsedTime().asMilliseconds() > UI_HIDE_TIMEOUT) {
+                ui_visible = false;
+                video_player_ui_window->setVisible(false);
+                //window.setMouseCursorVisible(false);
+            }
 
+            if(video_player_ui_window && ui_visible) {
                 const float ui_height = window_size.y * 0.025f;
                 if(ui_resize) {
-                    ui_resize = false;
                     video_player_ui_window->setSize(sf::Vector2u(window_size.x, ui_height));
                     video_player_ui_window->setPosition(sf::Vector2i(0, window_size.y - ui_height));
                 }
 
-                // TODO: Make window transparent, so the ui overlay for the video has transparency
-                video_player_ui_window->clear(sf::Color(33, 33, 33));
-                rect.setSize(sf::Vector2f(window_size.x * progress, ui_height));
-                video_player_ui_window->draw(rect);
-                video_player_ui_window->display();
-
-                if(sf::Mouse::isButtonPressed(sf::Mouse::Left)) {
-                    auto mouse_pos = sf::Mouse::getPosition(window);
-                    if(mouse_pos.y >= window_size.y - ui_height && mouse_pos.y <= window_size.y) {
-                        if(seekable)
-                            video_player->set_progress((double)mouse_pos.x / (double)window_size.x);
-                        else
-                            fprintf(stderr, "Video is not seekable!\n"); // TODO: Show this to the user
-                    }
+                const int progress_width = window_size.x * video_player->get_playback_state().progress;
+                if(ui_resize || progress_width != drawn_progress_width) {
+                    ui_resize = false;
+                    drawn_progress_width = progress_width;
+                    // TODO: Make window transparent, so the ui overlay for the video has transparency
+                    video_player_ui_window->clear(sf::Color(33, 33, 33));
+                    rect.setSize(sf::Vector2f(progress_width, ui_height));
+                    video_player_ui_window->draw(rect);
+                    video_player_ui_window->display();
                 }
-            } else {
-                std::this_thread::sleep_for(std::chrono::milliseconds(50));
             }
+
+            if(current_page != Page::VIDEO_CONTENT)
+                break;
+
+            int timeout_ms = -1;
+            if(video_player_ui_window && ui_visible)
+                timeout_ms = std::max(0, UI_HIDE_TIMEOUT - ui_hide_timer.getElapsedTime().asMilliseconds()) + 1;
+            // mpv doesn't notify the page when it can be connected to after it has created the ipc socket
+            if(!video_player->is_connected())
+                timeout_ms = min_timeout(timeout_ms, 100);
+            // mpv draws the video, so the window only has to be redrawn for the ui
+            if(wait_for_events(timeout_ms, { video_player->get_ipc_fd(), video_player->get_x11_fd() }))
+                ui_resize = true;
         }
 
+        video_player->set_event_callback(nullptr);
+        video_player->set_window_create_callback(nullptr);
+        video_player->stop();
         video_player_ui_window.reset();
         window_set_fullscreen(disp, window.getSystemHandle(), WindowFullscreenState::UNSET);
         //window.setMouseCursorVisible(true);
@@ -895,7 +1162,7 @@ namespace QuickMedia {
         images_url = item->url;
         chapter_title = item->title;
         image_index = 0;
-        current_page = Page::IMAGES;
+        current_page = get_image_view_page();
         if(start_from_beginning)
             return;
 
@@ -919,6 +1186,20 @@ namespace QuickMedia {
         return Page::EXIT;
     }
 
+    static const char* get_chapter_download_state_string(ChapterDownloadState state) {
+        switch(state) {
+            case ChapterDownloadState::QUEUED:
+                return "queued";
+            case ChapterDownloadState::DOWNLOADING:
+                return "downloading";
+            case ChapterDownloadState::FINISHED:
+                return "finished";
+            case ChapterDownloadState::FAILED:
+                return "failed";
+        }
+        return "";
+    }
+
     void Program::episode_list_page() {
         search_bar->onTextUpdateCallback = [this](const std::string &text) {
             body->filter_search_fuzzy(text);
@@ -939,22 +1220,43 @@ namespace QuickMedia {
         sf::Vector2f body_pos;
         sf::Vector2f body_size;
         bool redraw = true;
+        // The page is only drawn when something has changed
+        bool dirty = true;
         sf::Event event;
 
         while (current_page == Page::EPISODE_LIST) {
             while (window.pollEvent(event)) {
                 base_event_handler(event, Page::SEARCH_SUGGESTION);
+                dirty = true;
                 if(event.type == sf::Event::Resized || event.type == sf::Event::GainedFocus)
                     redraw = true;
                 else if(event.type == sf::Event::KeyPressed && event.key.code == sf::Keyboard::T && sf::Keyboard::isKeyPressed(sf::Keyboard::LControl)) {
                     BodyItem *selected_item = body->get_selected();
                     if(selected_item) {
                         if(track_media(TrackMediaType::HTML, content_title, selected_item->title, content_url) == 0) {
+                            // Tracked manga are kept in the cache, so the new chapters can be read offline
+                            if(manga_cache)
+                                manga_cache->set_pinned(manga_id_base64, true);
                             show_notification("Media tracker", "You are now tracking \"" + content_title + "\" after \"" + selected_item->title + "\"");
                         } else {
                             show_notification("Media tracker", "Failed to track media \"" + content_title + "\", chapter: \"" + selected_item->title + "\"", Urgency::CRITICAL);
                         }
                     }
+                } else if(event.type == sf::Event::KeyPressed && event.key.code == sf::Keyboard::E && sf::Keyboard::isKeyPressed(sf::Keyboard::LControl)) {
+                    BodyItem *selected_item = body->get_selected();
+                    if(selected_item)
+                        export_chapter_cbz(selected_item->title);
+                } else if(event.type == sf::Event::KeyPressed && event.key.code == sf::Keyboard::D && sf::Keyboard::isKeyPressed(sf::Keyboard::LControl)) {
+                    download_series();
+                } else if(event.type == sf::Event::KeyPressed && event.key.code == sf::Keyboard::P && sf::Keyboard::isKeyPressed(sf::Keyboard::LControl)) {
+                    if(manga_cache) {
+                        const bool pinned = !manga_cache->is_pinned(manga_id_base64);
+                        manga_cache->set_pinned(manga_id_base64, pinned);
+                        if(pinned)
+                            show_notification("Storage", "The downloaded chapters of \"" + content_title + "\" are kept for offline reading");
+                        else
+                            show_notification("Storage", "The downloaded chapters of \"" + content_title + "\" can be removed when the cache is full");
+                    }
                 }
             }
 
@@ -976,41 +1278,82 @@ namespace QuickMedia {
                 body_size = sf::Vector2f(body_width, window_size.y - search_bottom - body_padding_vertical);
             }
 
-            search_bar->update();
+            if(search_bar->update())
+                dirty = true;
+
+            if(current_page != Page::EPISODE_LIST)
+                break;
+
+            if(!dirty) {
+                if(wait_for_body_page_events(body))
+                    dirty = true;
+                continue;
+            }
+            dirty = false;
+
+            Json::Value json_download_progress(Json::objectValue);
+            if(series_downloader) {
+                for(auto &item : body->items) {
+                    ChapterDownloadProgress progress;
+                    if(series_downloader->get_chapter_progress(item->url, progress)) {
+                        Json::Value &json_progress = json_download_progress[item->title];
+                        json_progress["state"] = get_chapter_download_state_string(progress.state);
+                        json_progress["downloaded"] = progress.downloaded_pages;
+                        json_progress["total"] = progress.num_pages;
+                    }
+                }
+            }
 
             window.clear(back_color);
-            body->draw(window, body_pos, body_size, json_chapters);
+            body->draw(window, body_pos, body_size, json_chapters, json_download_progress);
             search_bar->draw(window);
             window.display();
         }
     }
 
-    // TODO: Optimize this somehow. One image alone uses more than 20mb ram! Total ram usage for viewing one image
-    // becomes 40mb (private memory, almost 100mb in total!) Unacceptable!
-    Program::LoadImageResult Program::load_image_by_index(int image_index, sf::Texture &image_texture, sf::String &error_message) {
-        Path image_path = content_cache_dir;
-        image_path.join(std::to_string(image_index + 1));
-
-        Path image_finished_path(image_path.data + ".finished");
-        if(get_file_type(image_finished_path) != FileType::FILE_NOT_FOUND && get_file_type(image_path) == FileType::REGULAR) {
-            std::string image_data;
-            if(file_get_content(image_path, image_data) == 0) {
-                if(image_texture.loadFromMemory(image_data.data(), image_data.size())) {
-                    image_texture.setSmooth(true);
-                    //image_texture.generateMipmap();
-                    return LoadImageResult::OK;
-                } else {
-                    error_message = std::string("Failed to load image for page ") + std::to_string(image_index + 1);
-                    return LoadImageResult::FAILED;
-                }
-            } else {
-                show_notification("Manganelo", "Failed to load image for page " + std::to_string(image_index + 1) + ". Image filepath: " + image_path.data, Urgency::CRITICAL);
-                error_message = std::string("Failed to load image for page ") + std::to_string(image_index + 1);
-                return LoadImageResult::FAILED;
-            }
+    void Program::download_series() {
+        if(!series_downloader)
+            return;
+
+        // The chapters are listed newest first, they are downloaded in the order they are read
+        std::vector<SeriesChapter> chapters;
+        for(auto it = body->items.rbegin(); it != body->items.rend(); ++it) {
+            chapters.push_back({ (*it)->title, (*it)->url, base64_encode((*it)->title) });
+        }
+
+        // Downloaded for offline reading, so they are not removed when the cache is full
+        if(manga_cache)
+            manga_cache->set_pinned(manga_id_base64, true);
+
+        int num_queued = series_downloader->queue_series(manga_id_base64, content_title, chapters);
+        if(num_queued == 0)
+            show_notification("Manga", "All chapters of \"" + content_title + "\" are downloaded or queued for download already");
+        else
+            show_notification("Manga", "Downloading " + std::to_string(num_queued) + " chapters of \"" + content_title + "\" in the background");
+    }
+
+    void Program::export_chapter_cbz(const std::string &chapter) {
+        Path chapter_cache_dir = get_cache_dir().join("manga").join(manga_id_base64).join(base64_encode(chapter));
+        Path export_dir = get_home_dir().join("Downloads");
+        if(create_directory_recursive(export_dir) != 0) {
+            show_notification("Storage", "Failed to create directory: " + export_dir.data, Urgency::CRITICAL);
+            return;
+        }
+
+        std::string filename = content_title + " - " + chapter + ".cbz";
+        std::replace(filename.begin(), filename.end(), '/', '_');
+        Path cbz_path = export_dir;
+        cbz_path.join(filename);
+
+        ChapterPack chapter_pack(chapter_cache_dir);
+        int num_pages = chapter_pack.export_cbz(cbz_path);
+        if(num_pages == -1) {
+            show_notification("Storage", "Failed to export \"" + chapter + "\" to " + cbz_path.data, Urgency::CRITICAL);
+        } else if(num_pages == 0) {
+            remove(cbz_path.data.c_str());
+            show_notification("Storage", "No pages of \"" + chapter + "\" have been downloaded", Urgency::CRITICAL);
         } else {
-            error_message = "Downloading page " + std::to_string(image_index + 1) + "...";
-            return LoadImageResult::DOWNLOAD_IN_PROGRESS;
+            show_notification("Storage", "Exported " + std::to_string(num_pages) + " pages of \"" + chapter + "\" to " + cbz_path.data);
         }
     }
 
@@ -1026,136 +1369,237 @@ namespace QuickMedia {
         }
 
         std::string chapter_url = images_url;
+        // The series downloader stops downloading the chapter, so the chapter is not downloaded twice
+        if(series_downloader)
+            series_downloader->set_reading_chapter(chapter_url);
+
         Path content_cache_dir_ = content_cache_dir;
-        image_download_future = std::async(std::launch::async, [chapter_url, image_plugin, content_cache_dir_, this]() {
+        std::string manga_id = manga_id_base64;
+        std::string chapter_dir = base64_encode(chapter_title);
+        image_download_future = std::async(std::launch::async, [chapter_url, image_plugin, content_cache_dir_, manga_id, chapter_dir, this]() {
             // TODO: Download images in parallel
-            int page = 1;
-            image_plugin->for_each_page_in_chapter(chapter_url, [content_cache_dir_, &page, this](const std::string &url) {
-                if(image_download_cancel)
-                    return false;
-                #if 0
-                size_t last_index = url.find_last_of('/');
-                if(last_index == std::string::npos || (int)url.size() - (int)last_index + 1 <= 0) {
-                    show_notification("Manganelo", "Image url is in incorrect format, missing '/': " + url, Urgency::CRITICAL);
+            ChapterPack chapter_pack(content_cache_dir_);
+            int page_index = 0;
+            bool pages_downloaded = true;
+            ImageResult image_result = image_plugin->for_each_page_in_chapter(chapter_url, [content_cache_dir_, image_plugin, &manga_id, &chapter_dir, &chapter_pack, &page_index, &pages_downloaded, this](const std::string &url) {
+                if(image_download_cancel) {
+                    pages_downloaded = false;
                     return false;
                 }
 
-                std::string image_filename = url.substr(last_index + 1);
-                Path image_filepath = content_cache_dir_;
-                image_filepath.join(image_filename);
-                #endif
-                Path image_filepath = content_cache_dir_;
-                image_filepath.join(std::to_string(page++));
-
-                Path lockfile_path(image_filepath.data + ".finished");
-                if(get_file_type(lockfile_path) != FileType::FILE_NOT_FOUND) 
-                    return true;
+                // The page decoder is told about the progress, so the page is shown while it's downloading
+                sf::Clock progress_timer;
+                auto on_progress = [this, &progress_timer](size_t) {
+                    if(progress_timer.getElapsedTime().asMilliseconds() >= PAGE_DOWNLOAD_PROGRESS_INTERVAL_MS) {
+                        progress_timer.restart();
+                        main_thread_tasks.post([this]() {
+                            if(page_decoder)
+                                page_decoder->check_downloaded_pages();
+                        });
+                    }
+                    return !image_download_cancel;
+                };
 
-                std::string image_content;
-                if(download_to_string(url, image_content, {}, current_plugin->use_tor) != DownloadResult::OK) {
-                    show_notification("Manganelo", "Failed to download image: " + url, Urgency::CRITICAL);
+                DownloadResult download_result = download_chapter_page(chapter_pack, content_cache_dir_, page_index++, image_plugin->get_page_mirror_urls(url), on_progress, {}, current_plugin->use_tor);
+                if(image_download_cancel) {
+                    pages_downloaded = false;
                     return false;
                 }
 
-                if(file_overwrite(image_filepath, image_content) != 0) {
-                    show_notification("Storage", "Failed to save image to file: " + image_filepath.data, Urgency::CRITICAL);
+                if(download_result == DownloadResult::ERR) {
+                    show_notification("Storage", "Failed to save image to the chapter in: " + content_cache_dir_.data, Urgency::CRITICAL);
+                    pages_downloaded = false;
                     return false;
-                }
-
-                if(create_lock_file(lockfile_path) != 0) {
-                    show_notification("Storage", "Failed to save image finished state to file: " + lockfile_path.data, Urgency::CRITICAL);
+                } else if(download_result != DownloadResult::OK) {
+                    show_notification("Manganelo", "Failed to download image: " + url, Urgency::CRITICAL);
+                    pages_downloaded = false;
                     return false;
                 }
+
+                if(manga_cache)
+                    manga_cache->update_chapter_size(manga_id, chapter_dir);
+
+                main_thread_tasks.post([this]() {
+                    if(page_decoder)
+                        page_decoder->check_downloaded_pages();
+                });
                 return true;
             });
+
+            if(image_result == ImageResult::OK && pages_downloaded)
+                chapter_pack.set_complete();
+            // The series downloader can download the rest of the chapter if it was not downloaded completely
+            if(series_downloader)
+                series_downloader->release_reading_chapter(chapter_url);
+            main_thread_tasks.post(nullptr);
         });
     }
 
-    void Program::image_page() {
-        search_bar->onTextUpdateCallback = nullptr;
-        search_bar->onTextSubmitCallback = nullptr;
-
-        sf::Texture image_texture;
-        sf::Sprite image;
-        sf::Text error_message("", font, 30);
-        error_message.setFillColor(sf::Color::White);
-
+    bool Program::load_chapter_images(int &num_images) {
         assert(current_plugin->name == "manganelo");
         Manganelo *image_plugin = static_cast<Manganelo*>(current_plugin);
-        std::string image_data;
-        bool download_in_progress = false;
 
         content_cache_dir = get_cache_dir().join("manga").join(manga_id_base64).join(base64_encode(chapter_title));
         if(create_directory_recursive(content_cache_dir) != 0) {
             show_notification("Storage", "Failed to create directory: " + content_cache_dir.data, Urgency::CRITICAL);
             current_page = Page::EPISODE_LIST;
-            return;
+            return false;
         }
+        if(manga_cache)
+            manga_cache->open_chapter(manga_id_base64, base64_encode(chapter_title));
         download_chapter_images_if_needed(image_plugin);
 
-        int num_images = 0;
+        num_images = 0;
         if(image_plugin->get_number_of_images(images_url, num_images) != ImageResult::OK) {
             show_notification("Plugin", "Failed to get number of images", Urgency::CRITICAL);
             current_page = Page::EPISODE_LIST;
-            return;
-        }
-        image_index = std::min(image_index, num_images);
-
-        if(image_index < num_images) {
-            sf::String error_msg;
-            LoadImageResult load_image_result = load_image_by_index(image_index, image_texture, error_msg);
-            if(load_image_result == LoadImageResult::OK)
-                image.setTexture(image_texture, true);
-            else if(load_image_result == LoadImageResult::DOWNLOAD_IN_PROGRESS)
-                download_in_progress = true;
-            error_message.setString(error_msg);
-        } else if(image_index == num_images) {
-            error_message.setString("End of " + chapter_title);
+            return false;
         }
+        image_index = std::max(0, std::min(image_index, num_images));
+
+        if(!page_decoder)
+            page_decoder = std::make_unique<PageDecoder>(main_thread_tasks);
+        page_decoder->set_chapter(content_cache_dir, num_images);
+        return true;
+    }
 
+    void Program::save_chapter_progress(int num_images) {
         Json::Value &json_chapters = content_storage_json["chapters"];
-        Json::Value json_chapter;
-        int latest_read = image_index + 1;
-        if(json_chapters.isObject()) {
-            json_chapter = json_chapters[chapter_title];
-            if(json_chapter.isObject()) {
-                const Json::Value &current = json_chapter["current"];
-                if(current.isNumeric())
-                    latest_read = std::max(latest_read, current.asInt());
-            } else {
-                json_chapter = Json::Value(Json::objectValue);
-            }
-        } else {
+        if(!json_chapters.isObject())
             json_chapters = Json::Value(Json::objectValue);
+        Json::Value &json_chapter = json_chapters[chapter_title];
+        if(!json_chapter.isObject())
             json_chapter = Json::Value(Json::objectValue);
-        }
-        json_chapter["current"] = std::min(latest_read, num_images);
+
+        // The progress file is only written when the progress has changed
+        const Json::Value &current = json_chapter["current"];
+        const Json::Value &total = json_chapter["total"];
+        int latest_read = image_index + 1;
+        if(current.isNumeric())
+            latest_read = std::max(latest_read, current.asInt());
+        latest_read = std::min(latest_read, num_images);
+        if(current.isNumeric() && current.asInt() == latest_read && total.isNumeric() && total.asInt() == num_images)
+            return;
+
+        json_chapter["current"] = latest_read;
         json_chapter["total"] = num_images;
-        json_chapters[chapter_title] = json_chapter;
         if(!save_manga_progress_json(content_storage_file, content_storage_json)) {
             show_notification("Manga progress", "Failed to save manga progress", Urgency::CRITICAL);
         }
+    }
+
+    Page Program::get_image_view_page() {
+        const Json::Value &continuous_scroll = content_storage_json["continuous_scroll"];
+        if(continuous_scroll.isBool() && continuous_scroll.asBool())
+            return Page::IMAGES_CONTINUOUS;
+        return Page::IMAGES;
+    }
+
+    void Program::toggle_image_view_page() {
+        // Remembered for each manga, since webtoons are read with continuous scrolling and other manga one page at a time
+        const bool continuous_scroll = get_image_view_page() != Page::IMAGES_CONTINUOUS;
+        content_storage_json["continuous_scroll"] = continuous_scroll;
+        if(!save_manga_progress_json(content_storage_file, content_storage_json)) {
+            show_notification("Manga progress", "Failed to save manga progress", Urgency::CRITICAL);
+        }
+        current_page = get_image_view_page();
+    }
+
+    // Draws the uploaded tiles of @page scaled by @scale, with the top left corner of the page at @pos.
+    // The tiles are positioned on whole pixels and stretched to the position of the next tile, so there are no gaps between them
+    static void draw_page_tiles(sf::RenderWindow &window, sf::Sprite &sprite, const DecodedPage &page, sf::Vector2f pos, float scale, unsigned int tile_height) {
+        for(size_t i = 0; i < page.tiles.size(); ++i) {
+            if(!page.tiles[i])
+                continue;
+
+            const float tile_texture_height = page.tiles[i]->getSize().y;
+            const float tile_top = std::floor(pos.y + i * tile_height * scale);
+            const float tile_bottom = std::floor(pos.y + (i * tile_height + tile_texture_height) * scale);
+            sprite.setTexture(*page.tiles[i], true);
+            sprite.setScale(scale, (tile_bottom - tile_top) / tile_texture_height);
+            sprite.setPosition(pos.x, tile_top);
+            window.draw(sprite);
+        }
+    }
+
+    static void draw_chapter_text(sf::RenderWindow &window, sf::Text &chapter_text, sf::RectangleShape &chapter_text_background, sf::Vector2f window_size, float font_height, float background_height) {
+        chapter_text_background.setSize(sf::Vector2f(window_size.x, background_height));
+        chapter_text_background.setPosition(0.0f, std::floor(window_size.y - background_height));
+        window.draw(chapter_text_background);
+
+        auto text_bounds = chapter_text.getLocalBounds();
+        chapter_text.setPosition(std::floor(window_size.x * 0.5f - text_bounds.width * 0.5f), std::floor(window_size.y - background_height * 0.5f - font_height * 0.5f));
+        window.draw(chapter_text);
+    }
+
+    static std::string get_page_message(const DecodedPage *decoded_page, int page_index, int num_images, const std::string &chapter_title) {
+        const std::string page_number = std::to_string(page_index + 1);
+        if(page_index == num_images)
+            return "End of " + chapter_title;
+        else if(!decoded_page || decoded_page->state == PageState::DECODING || decoded_page->has_image())
+            return "Loading page " + page_number + "...";
+        else if(decoded_page->state == PageState::DOWNLOADING)
+            return "Downloading page " + page_number + "...";
+        else
+            return "Failed to load image for page " + page_number;
+    }
+
+    void Program::image_page() {
+        search_bar->onTextUpdateCallback = nullptr;
+        search_bar->onTextSubmitCallback = nullptr;
+
+        sf::Sprite image;
+        sf::Text error_message("", font, 30);
+        error_message.setFillColor(sf::Color::White);
+
+        int num_images = 0;
+        if(!load_chapter_images(num_images))
+            return;
 
-        bool error = !error_message.getString().isEmpty();
         bool redraw = true;
         sf::Event event;
 
-        sf::Text chapter_text(chapter_title + " | Page " + std::to_string(image_index + 1) + "/" + std::to_string(num_images), font, 14);
-        if(image_index == num_images)
-            chapter_text.setString(chapter_title + " | End");
+        sf::Text chapter_text("", font, 14);
         chapter_text.setFillColor(sf::Color::White);
         sf::RectangleShape chapter_text_background;
         chapter_text_background.setFillColor(sf::Color(0, 0, 0, 150));
 
-        sf::Vector2u texture_size;
-        sf::Vector2f texture_size_f;
-        if(!error) {
-            texture_size = image.getTexture()->getSize();
-            texture_size_f = sf::Vector2f(texture_size.x, texture_size.y);
-        }
+        const float font_height = chapter_text.getCharacterSize() + 8.0f;
+        const float background_height = font_height + 6.0f;
+
+        // Pages are decoded to the size they are shown with
+        auto get_content_size = [this, background_height]() {
+            return sf::Vector2f(window_size.x, window_size.y - background_height);
+        };
+        auto get_max_page_size = [](const sf::Vector2f &content_size) {
+            return sf::Vector2u(std::max(1.0f, content_size.x), std::max(1.0f, content_size.y));
+        };
+
+        page_decoder->set_upload_decoded_pages(true);
+        page_decoder->set_max_page_size(get_max_page_size(get_content_size()));
+        page_decoder->set_current_page(image_index);
+        save_chapter_progress(num_images);
 
-        sf::Clock check_downloaded_timer;
-        const sf::Int32 check_downloaded_timeout_ms = 500;
+        auto update_chapter_text = [this, &chapter_text, num_images]() {
+            if(image_index == num_images)
+                chapter_text.setString(chapter_title + " | End");
+            else
+                chapter_text.setString(chapter_title + " | Page " + std::to_string(image_index + 1) + "/" + std::to_string(num_images));
+        };
+        update_chapter_text();
+
+        // Time from the key press to the new page being shown, including the time waiting for it to be decoded
+        sf::Clock page_flip_timer;
+        bool page_flip_in_progress = false;
+
+        auto on_page_changed = [this, &update_chapter_text, num_images, &page_flip_timer, &page_flip_in_progress, &redraw]() {
+            page_decoder->set_current_page(image_index);
+            update_chapter_text();
+            save_chapter_progress(num_images);
+            page_flip_timer.restart();
+            page_flip_in_progress = true;
+            redraw = true;
+        };
 
         // TODO: Show to user if a certain page is missing (by checking page name (number) and checking if some are skipped)
         while (current_page == Page::IMAGES) {
@@ -1174,7 +1618,7 @@ namespace QuickMedia {
                     if(event.key.code == sf::Keyboard::Up) {
                         if(image_index > 0) {
                             --image_index;
-                            return;
+                            on_page_changed();
                         } else if(image_index == 0 && body->selected_item < (int)body->items.size() - 1) {
                             // TODO: Make this work if the list is sorted differently than from newest to oldest.
                             body->selected_item++;
@@ -1185,76 +1629,330 @@ namespace QuickMedia {
                     } else if(event.key.code == sf::Keyboard::Down) {
                         if(image_index < num_images) {
                             ++image_index;
-                            return;
+                            on_page_changed();
                         } else if(image_index == num_images && body->selected_item > 0) {
                             // TODO: Make this work if the list is sorted differently than from newest to oldest.
                             body->selected_item--;
                             select_episode(body->items[body->selected_item].get(), true);
                             return;
                         }
+                    } else if(event.key.code == sf::Keyboard::Tab) {
+                        toggle_image_view_page();
                     } else if(event.key.code == sf::Keyboard::Escape) {
                         current_page = Page::EPISODE_LIST;
                     }
                 }
             }
 
-            if(download_in_progress && check_downloaded_timer.getElapsedTime().asMilliseconds() >= check_downloaded_timeout_ms) {
-                sf::String error_msg;
-                LoadImageResult load_image_result = load_image_by_index(image_index, image_texture, error_msg);
-                if(load_image_result == LoadImageResult::OK) {
-                    image.setTexture(image_texture, true);
-                    download_in_progress = false;
-                    error = false;
-                    texture_size = image.getTexture()->getSize();
-                    texture_size_f = sf::Vector2f(texture_size.x, texture_size.y);
-                } else if(load_image_result == LoadImageResult::FAILED) {
-                    download_in_progress = false;
+            if(current_page != Page::IMAGES)
+                break;
+
+            if(redraw) {
+                redraw = false;
+
+                const sf::Vector2f content_size = get_content_size();
+                page_decoder->set_max_page_size(get_max_page_size(content_size));
+
+                // Does nothing if the page is already uploaded, which it is unless it was decoded while the continuous scroll mode was used
+                if(image_index < num_images)
+                    page_decoder->update_tiles(image_index, 0, UINT_MAX);
+                const DecodedPage *decoded_page = image_index < num_images ? page_decoder->get_page(image_index) : nullptr;
+                // Pages that are still downloading are shown as far as they have been downloaded
+                const bool page_loaded = decoded_page && decoded_page->has_image();
+
+                window.clear(back_color);
+
+                if(page_loaded) {
+                    // The decoded image can be smaller than the page, if the page was decoded for a smaller window
+                    sf::Vector2f page_size_f(decoded_page->size.x, decoded_page->size.y);
+                    auto image_size = clamp_to_size(page_size_f, content_size);
+                    const float image_scale = image_size.x / decoded_page->image->getSize().x;
+                    sf::Vector2f image_pos(std::floor(content_size.x * 0.5f - image_size.x * 0.5f), std::floor(content_size.y * 0.5f - image_size.y * 0.5f));
+                    draw_page_tiles(window, image, *decoded_page, image_pos, image_scale, page_decoder->get_tile_height());
+                } else {
+                    error_message.setString(get_page_message(decoded_page, image_index, num_images, chapter_title));
+                    auto bounds = error_message.getLocalBounds();
+                    error_message.setPosition(std::floor(content_size.x * 0.5f - bounds.width * 0.5f), std::floor(content_size.y * 0.5f - bounds.height));
+                    window.draw(error_message);
                 }
-                error_message.setString(error_msg);
+
+                draw_chapter_text(window, chapter_text, chapter_text_background, window_size, font_height, background_height);
+                window.display();
+
+                if(page_flip_in_progress && (page_loaded || image_index == num_images || (decoded_page && decoded_page->state == PageState::FAILED))) {
+                    instrumentation_record("page flip", page_flip_timer.getElapsedTime().asMicroseconds() * 0.001);
+                    page_flip_in_progress = false;
+                }
+            }
+
+            // Decoded pages and downloaded pages are posted to the main thread tasks, which wakes this up
+            if(wait_for_events(-1))
                 redraw = true;
-                check_downloaded_timer.restart();
+        }
+    }
+
+    // Pages are not upscaled to fill the width of the window, since normal manga pages would be much taller than the window then
+    static float get_continuous_page_scale(sf::Vector2u page_size, const sf::Vector2f &content_size) {
+        return std::min(1.0f, content_size.x / (float)page_size.x);
+    }
+
+    void Program::image_continuous_page() {
+        search_bar->onTextUpdateCallback = nullptr;
+        search_bar->onTextSubmitCallback = nullptr;
+
+        sf::Sprite tile_sprite;
+        sf::Text page_message("", font, 30);
+        page_message.setFillColor(sf::Color::White);
+
+        int num_images = 0;
+        if(!load_chapter_images(num_images))
+            return;
+        // Only the tiles around the visible part of the chapter are uploaded, so long chapters are not kept on the gpu
+        page_decoder->set_upload_decoded_pages(false);
+        save_chapter_progress(num_images);
+
+        // Pages are decoded to the width they are shown with, the height doesn't limit the size
+        auto get_max_page_size = [](const sf::Vector2f &content_size) {
+            return sf::Vector2u(std::max(1.0f, content_size.x), 0);
+        };
+
+        // Holding up/down scrolls this many window heights per second
+        const float KEY_SCROLL_SPEED = 1.5f;
+        const float WHEEL_SCROLL_STEP = 120.0f;
+        // The fraction of the remaining smooth scroll (page up/down, mouse wheel) that is scrolled in a second
+        const float SMOOTH_SCROLL_RATE = 15.0f;
+
+        bool redraw = true;
+        sf::Event event;
+
+        sf::Text chapter_text("", font, 14);
+        chapter_text.setFillColor(sf::Color::White);
+        sf::RectangleShape chapter_text_background;
+        chapter_text_background.setFillColor(sf::Color(0, 0, 0, 150));
+
+        const float font_height = chapter_text.getCharacterSize() + 8.0f;
+        const float background_height = font_height + 6.0f;
+
+        auto update_chapter_text = [this, &chapter_text, num_images]() {
+            if(image_index == num_images)
+                chapter_text.setString(chapter_title + " | End");
+            else
+                chapter_text.setString(chapter_title + " | Page " + std::to_string(image_index + 1) + "/" + std::to_string(num_images));
+        };
+        update_chapter_text();
+
+        auto get_content_size = [this, background_height]() {
+            return sf::Vector2f(window_size.x, window_size.y - background_height);
+        };
+        page_decoder->set_max_page_size(get_max_page_size(get_content_size()));
+
+        // Pages that have not been decoded yet are as tall as the window until their size is known. The page after the last page
+        // shows that it's the end of the chapter
+        auto get_page_height = [this, num_images](int page_index, const sf::Vector2f &content_size) {
+            sf::Vector2u page_size;
+            if(page_index == num_images || !page_decoder->get_page_size(page_index, page_size))
+                return std::max(1.0f, content_size.y);
+            return std::max(1.0f, std::floor(page_size.y * get_continuous_page_scale(page_size, content_size)));
+        };
+
+        // The top of the window is at |scroll_progress| (0-1) of page |image_index|. A fraction of the page is used instead of pixels,
+        // so the view stays at the same place in the page when the page gets its real height or the window is resized
+        float scroll_progress = 0.0f;
+        // Left to scroll with smooth scrolling, in pixels
+        float scroll_remaining = 0.0f;
+        // -1 or 1 while up or down is held
+        int scroll_direction = 0;
+        sf::Clock frame_timer;
+
+        // Returns false if the top or the end of the chapter was reached
+        auto scroll = [this, num_images, &get_page_height, &update_chapter_text, &scroll_progress](float delta, const sf::Vector2f &content_size) {
+            const int prev_image_index = image_index;
+            float scroll_offset = scroll_progress * get_page_height(image_index, content_size) + delta;
+            while(scroll_offset < 0.0f && image_index > 0) {
+                --image_index;
+                scroll_offset += get_page_height(image_index, content_size);
+            }
+            while(image_index < num_images && scroll_offset >= get_page_height(image_index, content_size)) {
+                scroll_offset -= get_page_height(image_index, content_size);
+                ++image_index;
             }
 
-            const float font_height = chapter_text.getCharacterSize() + 8.0f;
-            const float background_height = font_height + 6.0f;
+            bool scrolled = true;
+            if(scroll_offset < 0.0f || image_index == num_images) {
+                scroll_offset = 0.0f;
+                scrolled = false;
+            }
+            scroll_progress = scroll_offset / get_page_height(image_index, content_size);
 
-            sf::Vector2f content_size;
-            content_size.x = window_size.x;
-            content_size.y = window_size.y - background_height;
+            if(image_index != prev_image_index) {
+                update_chapter_text();
+                save_chapter_progress(num_images);
+            }
+            return scrolled;
+        };
+
+        int first_visible_page = -1;
+        int last_visible_page = -1;
+
+        struct PagePosition {
+            int page_index;
+            float y;
+            float height;
+        };
+        std::vector<PagePosition> page_positions;
+
+        // TODO: Show to user if a certain page is missing (by checking page name (number) and checking if some are skipped)
+        while (current_page == Page::IMAGES_CONTINUOUS) {
+            const sf::Vector2f content_size = get_content_size();
+            while(window.pollEvent(event)) {
+                if (event.type == sf::Event::Closed) {
+                    current_page = Page::EXIT;
+                } else if(event.type == sf::Event::Resized) {
+                    window_size.x = event.size.width;
+                    window_size.y = event.size.height;
+                    sf::FloatRect visible_area(0, 0, window_size.x, window_size.y);
+                    window.setView(sf::View(visible_area));
+                    redraw = true;
+                } else if(event.type == sf::Event::GainedFocus) {
+                    redraw = true;
+                } else if(event.type == sf::Event::KeyPressed) {
+                    if(event.key.code == sf::Keyboard::Up) {
+                        if(image_index == 0 && scroll_progress <= 0.0f) {
+                            if(body->selected_item < (int)body->items.size() - 1) {
+                                // TODO: Make this work if the list is sorted differently than from newest to oldest.
+                                body->selected_item++;
+                                select_episode(body->items[body->selected_item].get(), true);
+                                image_index = 99999; // Start at the page that shows we are at the end of the chapter
+                                return;
+                            }
+                        } else {
+                            scroll_direction = -1;
+                        }
+                    } else if(event.key.code == sf::Keyboard::Down) {
+                        if(image_index == num_images) {
+                            if(body->selected_item > 0) {
+                                // TODO: Make this work if the list is sorted differently than from newest to oldest.
+                                body->selected_item--;
+                                select_episode(body->items[body->selected_item].get(), true);
+                                return;
+                            }
+                        } else {
+                            scroll_direction = 1;
+                        }
+                    } else if(event.key.code == sf::Keyboard::PageUp) {
+                        scroll_remaining -= content_size.y * 0.9f;
+                    } else if(event.key.code == sf::Keyboard::PageDown || event.key.code == sf::Keyboard::Space) {
+                        scroll_remaining += content_size.y * 0.9f;
+                    } else if(event.key.code == sf::Keyboard::Tab) {
+                        toggle_image_view_page();
+                    } else if(event.key.code == sf::Keyboard::Escape) {
+                        current_page = Page::EPISODE_LIST;
+                    }
+                } else if(event.type == sf::Event::KeyReleased) {
+                    if((event.key.code == sf::Keyboard::Up && scroll_direction == -1) || (event.key.code == sf::Keyboard::Down && scroll_direction == 1))
+                        scroll_direction = 0;
+                } else if(event.type == sf::Event::MouseWheelScrolled && event.mouseWheelScroll.wheel == sf::Mouse::VerticalWheel) {
+                    scroll_remaining -= event.mouseWheelScroll.delta * WHEEL_SCROLL_STEP;
+                }
+            }
+
+            if(current_page != Page::IMAGES_CONTINUOUS)
+                break;
+
+            // The frame time is only used while scrolling, the first frame after waiting for events scrolls as if it was one frame late
+            const float frame_time = std::min(frame_timer.restart().asSeconds(), 1.0f / 30.0f);
+            float scroll_delta = scroll_direction * KEY_SCROLL_SPEED * content_size.y * frame_time;
+            if(scroll_remaining != 0.0f) {
+                float step = scroll_remaining * std::min(1.0f, frame_time * SMOOTH_SCROLL_RATE);
+                if(std::abs(scroll_remaining - step) < 1.0f)
+                    step = scroll_remaining;
+                scroll_remaining -= step;
+                scroll_delta += step;
+            }
+
+            if(scroll_delta != 0.0f) {
+                if(!scroll(scroll_delta, content_size)) {
+                    scroll_remaining = 0.0f;
+                    scroll_direction = 0;
+                }
+                redraw = true;
+            }
 
             if(redraw) {
                 redraw = false;
-                if(error) {
-                    auto bounds = error_message.getLocalBounds();
-                    error_message.setPosition(std::floor(content_size.x * 0.5f - bounds.width * 0.5f), std::floor(content_size.y * 0.5f - bounds.height));
-                } else {
-                    auto image_scale = get_ratio(texture_size_f, clamp_to_size(texture_size_f, content_size));
-                    image.setScale(image_scale);
 
-                    auto image_size = texture_size_f;
-                    image_size.x *= image_scale.x;
-                    image_size.y *= image_scale.y;
-                    image.setPosition(std::floor(content_size.x * 0.5f - image_size.x * 0.5f), std::floor(content_size.y * 0.5f - image_size.y * 0.5f));
+                // Tiles are uploaded this far above and below the window, so they are ready when they are scrolled into view
+                const float tile_margin = content_size.y;
+                page_decoder->set_max_page_size(get_max_page_size(content_size));
+
+                page_positions.clear();
+                int page_index = image_index;
+                float page_y = -std::floor(scroll_progress * get_page_height(image_index, content_size));
+                while(page_index > 0 && page_y > -tile_margin) {
+                    --page_index;
+                    page_y -= get_page_height(page_index, content_size);
+                }
+                for(; page_index <= num_images && page_y < content_size.y + tile_margin; ++page_index) {
+                    const float page_height = get_page_height(page_index, content_size);
+                    page_positions.push_back({ page_index, page_y, page_height });
+                    page_y += page_height;
                 }
 
-                window.clear(back_color);
+                int new_last_visible_page = image_index;
+                for(const PagePosition &page_position : page_positions) {
+                    if(page_position.y < content_size.y)
+                        new_last_visible_page = std::max(new_last_visible_page, page_position.page_index);
+                }
+                new_last_visible_page = std::min(new_last_visible_page, num_images - 1);
 
-                if(error) {
-                    window.draw(error_message);
-                } else {
-                    window.draw(image);
+                if(image_index != first_visible_page || new_last_visible_page != last_visible_page) {
+                    first_visible_page = image_index;
+                    last_visible_page = new_last_visible_page;
+                    page_decoder->set_page_range(std::min(first_visible_page, num_images - 1), last_visible_page);
                 }
+                if(!page_positions.empty())
+                    page_decoder->free_tiles_outside(page_positions.front().page_index, page_positions.back().page_index);
+
+                window.clear(back_color);
+
+                for(const PagePosition &page_position : page_positions) {
+                    const DecodedPage *decoded_page = page_position.page_index < num_images ? page_decoder->get_page(page_position.page_index) : nullptr;
+                    // The decoded image can be smaller than the page, if the page was decoded for a smaller window
+                    float image_scale = 1.0f;
+                    if(decoded_page && decoded_page->has_image()) {
+                        image_scale = get_continuous_page_scale(decoded_page->size, content_size) * decoded_page->size.x / decoded_page->image->getSize().x;
+                        const float tile_top = std::max(0.0f, (-tile_margin - page_position.y) / image_scale);
+                        const float tile_bottom = std::max(0.0f, (content_size.y + tile_margin - page_position.y) / image_scale);
+                        page_decoder->update_tiles(page_position.page_index, tile_top, tile_bottom);
+                    }
+
+                    if(page_position.y + page_position.height <= 0.0f || page_position.y >= content_size.y)
+                        continue;
 
-                chapter_text_background.setSize(sf::Vector2f(window_size.x, background_height));
-                chapter_text_background.setPosition(0.0f, std::floor(window_size.y - background_height));
-                window.draw(chapter_text_background);
+                    // The page might have failed to upload
+                    if(decoded_page && decoded_page->has_image()) {
+                        const float image_width = decoded_page->image->getSize().x * image_scale;
+                        sf::Vector2f page_pos(std::floor(content_size.x * 0.5f - image_width * 0.5f), page_position.y);
+                        draw_page_tiles(window, tile_sprite, *decoded_page, page_pos, image_scale, page_decoder->get_tile_height());
+                    } else {
+                        page_message.setString(get_page_message(decoded_page, page_position.page_index, num_images, chapter_title));
+                        auto bounds = page_message.getLocalBounds();
+                        const float visible_top = std::max(0.0f, page_position.y);
+                        const float visible_bottom = std::min(content_size.y, page_position.y + page_position.height);
+                        page_message.setPosition(std::floor(content_size.x * 0.5f - bounds.width * 0.5f), std::floor((visible_top + visible_bottom) * 0.5f - bounds.height));
+                        window.draw(page_message);
+                    }
+                }
 
-                auto text_bounds = chapter_text.getLocalBounds();
-                chapter_text.setPosition(std::floor(window_size.x * 0.5f - text_bounds.width * 0.5f), std::floor(window_size.y - background_height * 0.5f - font_height * 0.5f));
-                window.draw(chapter_text);
+                draw_chapter_text(window, chapter_text, chapter_text_background, window_size, font_height, background_height);
+                // Waits for vertical sync, which paces the frames while scrolling
+                window.display();
             }
 
-            window.display();
+            // Decoded pages and downloaded pages are posted to the main thread tasks, which wakes this up
+            const bool scrolling = scroll_direction != 0 || scroll_remaining != 0.0f;
+            if(wait_for_events(scrolling ? 0 : -1))
+                redraw = true;
         }
     }
 
@@ -1285,11 +1983,14 @@ namespace QuickMedia {
         sf::Vector2f body_pos;
         sf::Vector2f body_size;
         bool redraw = true;
+        // The page is only drawn when something has changed
+        bool dirty = true;
         sf::Event event;
 
         while (current_page == Page::CONTENT_LIST) {
             while (window.pollEvent(event)) {
                 base_event_handler(event, Page::SEARCH_SUGGESTION);
+                dirty = true;
                 if(event.type == sf::Event::Resized || event.type == sf::Event::GainedFocus)
                     redraw = true;
             }
@@ -1312,7 +2013,18 @@ namespace QuickMedia {
                 body_size = sf::Vector2f(body_width, window_size.y - search_bottom - body_padding_vertical);
             }
 
-            search_bar->update();
+            if(search_bar->update())
+                dirty = true;
+
+            if(current_page != Page::CONTENT_LIST)
+                break;
+
+            if(!dirty) {
+                if(wait_for_body_page_events(body))
+                    dirty = true;
+                continue;
+            }
+            dirty = false;
 
             window.clear(back_color);
             body->draw(window, body_pos, body_size);
@@ -1345,11 +2057,14 @@ namespace QuickMedia {
         sf::Vector2f body_pos;
         sf::Vector2f body_size;
         bool redraw = true;
+        // The page is only drawn when something has changed
+        bool dirty = true;
         sf::Event event;
 
         while (current_page == Page::CONTENT_DETAILS) {
             while (window.pollEvent(event)) {
                 base_event_handler(event, Page::CONTENT_LIST);
+                dirty = true;
                 if(event.type == sf::Event::Resized || event.type == sf::Event::GainedFocus)
                     redraw = true;
             }
@@ -1372,7 +2087,18 @@ namespace QuickMedia {
                 body_size = sf::Vector2f(body_width, window_size.y - search_bottom - body_padding_vertical);
             }
 
-            search_bar->update();
+            if(search_bar->update())
+                dirty = true;
+
+            if(current_page != Page::CONTENT_DETAILS)
+                break;
+
+            if(!dirty) {
+                if(wait_for_body_page_events(body))
+                    dirty = true;
+                continue;
+            }
+            dirty = false;
 
             window.clear(back_color);
             body->draw(window, body_pos, body_size);
@@ -1390,8 +2116,10 @@ namespace QuickMedia {
             return;
         }
 
-        search_bar->onTextUpdateCallback = [this](const std::string &text) {
-            body->filter_search_fuzzy(text);
+        search_bar->onTextUpdateCallback = [this, image_board](const std::string &text) {
+            body->clear_items();
+            if(image_board->search_threads(image_board_thread_list_url, text, body->items) != PluginResult::OK)
+                show_notification("Search", "Failed to search threads in " + image_board_thread_list_url, Urgency::CRITICAL);
             body->select_first_item();
         };
 
@@ -1410,11 +2138,14 @@ namespace QuickMedia {
         sf::Vector2f body_pos;
         sf::Vector2f body_size;
         bool redraw = true;
+        // The page is only drawn when something has changed
+        bool dirty = true;
         sf::Event event;
 
         while (current_page == Page::IMAGE_BOARD_THREAD_LIST) {
             while (window.pollEvent(event)) {
                 base_event_handler(event, Page::SEARCH_SUGGESTION);
+                dirty = true;
                 if(event.type == sf::Event::Resized || event.type == sf::Event::GainedFocus)
                     redraw = true;
             }
@@ -1437,7 +2168,18 @@ namespace QuickMedia {
                 body_size = sf::Vector2f(body_width, window_size.y - search_bottom - body_padding_vertical);
             }
 
-            search_bar->update();
+            if(search_bar->update())
+                dirty = true;
+
+            if(current_page != Page::IMAGE_BOARD_THREAD_LIST)
+                break;
+
+            if(!dirty) {
+                if(wait_for_body_page_events(body))
+                    dirty = true;
+                continue;
+            }
+            dirty = false;
 
             window.clear(back_color);
             body->draw(window, body_pos, body_size);
@@ -1541,7 +2283,7 @@ namespace QuickMedia {
             }
             const std::string referer = "https://boards.4chan.org/";
             captcha_request_future = google_captcha_request_challenge(fourchan_google_captcha_api_key, referer,
-                [&navigation_stage, &request_google_captcha_image, &challenge_info](std::optional<GoogleCaptchaChallengeInfo> new_challenge_info) {
+                [this, &navigation_stage, &request_google_captcha_image, &challenge_info](std::optional<GoogleCaptchaChallengeInfo> new_challenge_info) {
                     if(navigation_stage != NavigationStage::SOLVING_POST_CAPTCHA)
                         return;
 
@@ -1552,6 +2294,7 @@ namespace QuickMedia {
                         show_notification("Google captcha", "Failed to get captcha challenge", Urgency::CRITICAL);
                         navigation_stage = NavigationStage::VIEWING_COMMENTS;
                     }
+                    main_thread_tasks.post(nullptr);
                 }, current_plugin->use_tor);
         };
 
@@ -1578,6 +2321,7 @@ namespace QuickMedia {
                 show_notification(current_plugin->name, "Failed to post comment. Unknown error", Urgency::CRITICAL);
                 navigation_stage = NavigationStage::VIEWING_COMMENTS;
             }
+            main_thread_tasks.post(nullptr);
         };
 
         // Instead of using search bar to searching, use it for commenting.
@@ -1603,12 +2347,15 @@ namespace QuickMedia {
         sf::Vector2f body_pos;
         sf::Vector2f body_size;
         bool redraw = true;
+        // The page is only drawn when something has changed
+        bool dirty = true;
         sf::Event event;
 
         std::stack<int> comment_navigation_stack;
 
         while (current_page == Page::IMAGE_BOARD_THREAD) {
             while (window.pollEvent(event)) {
+                dirty = true;
                 if (event.type == sf::Event::Closed) {
                     current_page = Page::EXIT;
                 } else if(event.type == sf::Event::Resized) {
@@ -1643,7 +2390,15 @@ namespace QuickMedia {
                                 content_url = std::move(prev_content_url);
                             } else {
                                 navigation_stage = NavigationStage::VIEWING_ATTACHED_IMAGE;
-                                load_image_future = std::async(std::launch::async, [this, &image_board, &attached_image_texture, &attached_image_sprite, &attachment_load_mutex]() -> bool {
+                                // The image is decoded to the size it's shown with
+                                const sf::Vector2u max_image_size(std::max(1.0f, window_size.x), std::max(1.0f, window_size.y));
+                                load_image_future = std::async(std::launch::async, [this, &image_board, &attached_image_texture, &attached_image_sprite, &attachment_load_mutex, max_image_size]() -> bool {
+                                    // Wakes up the page when the image has been loaded or failed to load
+                                    struct WakeUpScope {
+                                        ~WakeUpScope() { tasks.post(nullptr); }
+                                        TaskQueue &tasks;
+                                    } wake_up_scope{main_thread_tasks};
+
                                     BodyItem *selected_item = body->get_selected();
                                     if(!selected_item || selected_item->attached_content_url.empty()) {
                                         return false;
@@ -1654,8 +2409,15 @@ namespace QuickMedia {
                                         return false;
                                     }
 
+                                    sf::Image image;
+                                    sf::Vector2u image_file_size;
+                                    if(!decode_image_scaled(image_data.data(), image_data.size(), max_image_size, image, image_file_size)) {
+                                        show_notification(image_board->name, "Failed to load image downloaded from url: " + selected_item->attached_content_url, Urgency::CRITICAL);
+                                        return false;
+                                    }
+
                                     std::lock_guard<std::mutex> lock(attachment_load_mutex);
-                                    if(!attached_image_texture->loadFromMemory(image_data.data(), image_data.size())) {
+                                    if(!attached_image_texture->loadFromImage(image)) {
                                         show_notification(image_board->name, "Failed to load image downloaded from url: " + selected_item->attached_content_url, Urgency::CRITICAL);
                                         return false;
                                     }
@@ -1737,7 +2499,7 @@ namespace QuickMedia {
                     } else if(event.key.code == sf::Keyboard::Enter) {
                         navigation_stage = NavigationStage::POSTING_SOLUTION;
                         captcha_post_solution_future = google_captcha_post_solution(fourchan_google_captcha_api_key, challenge_info.id, selected_captcha_images,
-                            [&navigation_stage, &captcha_post_id, &captcha_solved_time, &selected_captcha_images, &challenge_info, &request_google_captcha_image, &post_comment](std::optional<std::string> new_captcha_post_id, std::optional<GoogleCaptchaChallengeInfo> new_challenge_info) {
+                            [this, &navigation_stage, &captcha_post_id, &captcha_solved_time, &selected_captcha_images, &challenge_info, &request_google_captcha_image, &post_comment](std::optional<std::string> new_captcha_post_id, std::optional<GoogleCaptchaChallengeInfo> new_challenge_info) {
                                 if(navigation_stage != NavigationStage::POSTING_SOLUTION)
                                     return;
 
@@ -1754,6 +2516,7 @@ namespace QuickMedia {
                                     }
                                     request_google_captcha_image(challenge_info);
                                 }
+                                main_thread_tasks.post(nullptr);
                             }, current_plugin->use_tor);
                     }
                 }
@@ -1792,6 +2555,16 @@ namespace QuickMedia {
 
             //search_bar->update();
 
+            if(current_page != Page::IMAGE_BOARD_THREAD)
+                break;
+
+            if(!dirty) {
+                if(wait_for_body_page_events(body))
+                    dirty = true;
+                continue;
+            }
+            dirty = false;
+
             window.clear(back_color);
             if(navigation_stage == NavigationStage::SOLVING_POST_CAPTCHA) {
                 std::lock_guard<std::mutex> lock(captcha_image_mutex);
@@ -1,6 +1,7 @@
 #include "../include/SearchBar.hpp"
 #include "../include/Scale.hpp"
 #include <cmath>
+#include <algorithm>
 #include <assert.h>
 
 const sf::Color text_placeholder_color(255, 255, 255, 100);
@@ -47,7 +48,7 @@ namespace QuickMedia {
             window.draw(plugin_logo_sprite);
     }
 
-    void SearchBar::update() {
+    bool SearchBar::update() {
         if(updated_search && time_since_search_update.getElapsedTime().asMilliseconds() >= text_autosearch_delay) {
             time_since_search_update.restart();
             updated_search = false;
@@ -56,7 +57,15 @@ namespace QuickMedia {
                 str.clear();
             if(onTextUpdateCallback)
                 onTextUpdateCallback(str);
+            return true;
         }
+        return false;
+    }
+
+    int SearchBar::get_update_timeout_ms() const {
+        if(!updated_search)
+            return -1;
+        return std::max(0, text_autosearch_delay - time_since_search_update.getElapsedTime().asMilliseconds());
     }
 
     void SearchBar::onWindowResize(const sf::Vector2f &window_size) {
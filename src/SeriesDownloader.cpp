@@ -0,0 +1,352 @@
+#include "../include/SeriesDownloader.hpp"
+#include "../include/ChapterPack.hpp"
+#include "../include/MangaCache.hpp"
+#include "../include/Storage.hpp"
+#include "../plugins/Manganelo.hpp"
+#include <json/reader.h>
+#include <json/writer.h>
+#include <algorithm>
+#include <memory>
+#include <stdio.h>
+
+namespace QuickMedia {
+    // The number of chapters that are downloaded at the same time
+    static const int NUM_DOWNLOAD_THREADS = 2;
+
+    DownloadResult download_chapter_page(ChapterPack &chapter_pack, const Path &chapter_cache_dir, int page_index, const std::vector<std::string> &urls,
+        DownloadProgressCallback progress_callback, const std::vector<CommandArg> &additional_args, bool use_tor, bool background)
+    {
+        if(chapter_pack.has_page(page_index))
+            return DownloadResult::OK;
+
+        Path image_filepath = chapter_cache_dir;
+        image_filepath.join(std::to_string(page_index + 1));
+
+        // Downloads are written to a part file that is renamed when it's complete, so the page file exists only when it has been downloaded.
+        // Page files from caches before the chapter pack was used are moved to the pack
+        if(get_file_type(image_filepath) != FileType::REGULAR) {
+            if(background)
+                image_filepath.data += ".background";
+            DownloadResult download_result = download_to_file_from_mirrors(urls, image_filepath, progress_callback, additional_args, use_tor);
+            if(download_result != DownloadResult::OK)
+                return download_result;
+        }
+
+        std::string image_data;
+        if(file_get_content(image_filepath, image_data) != 0 || !chapter_pack.add_page(page_index, image_data))
+            return DownloadResult::ERR;
+        remove(image_filepath.data.c_str());
+        // Caches from before part files were used have a .finished file for each downloaded page
+        remove((image_filepath.data + ".finished").c_str());
+        return DownloadResult::OK;
+    }
+
+    SeriesDownloader::SeriesDownloader(Manganelo *plugin, MangaCache *manga_cache, int max_download_rate, std::function<void()> progress_callback) :
+        plugin(plugin), manga_cache(manga_cache), progress_callback(std::move(progress_callback)), running(true), active_chapters(NUM_DOWNLOAD_THREADS)
+    {
+        // curl limits the rate of each download, so the limit is shared between the downloads
+        if(max_download_rate > 0)
+            download_args.push_back({ "--limit-rate", std::to_string(std::max(1, max_download_rate / NUM_DOWNLOAD_THREADS)) });
+
+        queue_path = get_storage_dir().join("manga_downloads.json");
+        load_queue();
+        for(int i = 0; i < NUM_DOWNLOAD_THREADS; ++i) {
+            download_threads.emplace_back(&SeriesDownloader::download_thread_func, this, i);
+        }
+    }
+
+    SeriesDownloader::~SeriesDownloader() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            running = false;
+            for(ActiveChapter &active_chapter : active_chapters) {
+                active_chapter.cancel = true;
+            }
+        }
+        queue_cond.notify_all();
+        for(std::thread &download_thread : download_threads) {
+            download_thread.join();
+        }
+        // The chapters that were downloading have been put back in the queue
+        std::unique_lock<std::mutex> lock(mutex);
+        save_queue(lock);
+    }
+
+    int SeriesDownloader::queue_series(const std::string &manga_id, const std::string &manga_name, const std::vector<SeriesChapter> &chapters) {
+        int num_queued = 0;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            manga_names[manga_id] = manga_name;
+            for(const SeriesChapter &chapter : chapters) {
+                auto progress_it = chapter_progress.find(chapter.url);
+                if(progress_it != chapter_progress.end() && progress_it->second.state != ChapterDownloadState::FAILED)
+                    continue;
+
+                failed_chapters.erase(std::remove_if(failed_chapters.begin(), failed_chapters.end(), [&chapter](const QueuedChapter &failed_chapter) {
+                    return failed_chapter.chapter.url == chapter.url;
+                }), failed_chapters.end());
+
+                chapter_progress[chapter.url] = ChapterDownloadProgress();
+                queue.push_back({ manga_id, chapter });
+                ++num_queued;
+            }
+            save_queue(lock);
+        }
+        queue_cond.notify_all();
+        return num_queued;
+    }
+
+    bool SeriesDownloader::get_chapter_progress(const std::string &chapter_url, ChapterDownloadProgress &progress) {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = chapter_progress.find(chapter_url);
+        if(it == chapter_progress.end())
+            return false;
+        progress = it->second;
+        return true;
+    }
+
+    void SeriesDownloader::set_reading_chapter(const std::string &chapter_url) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            reading_chapter_url = chapter_url;
+            // The page that is downloading stops a moment later. It's downloaded to another part file than the image page uses, so it's not waited for
+            for(ActiveChapter &active_chapter : active_chapters) {
+                if(active_chapter.active && active_chapter.queued_chapter.chapter.url == chapter_url)
+                    active_chapter.cancel = true;
+            }
+        }
+        // The chapter that was read before can be downloaded now
+        queue_cond.notify_all();
+    }
+
+    void SeriesDownloader::release_reading_chapter(const std::string &chapter_url) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if(reading_chapter_url != chapter_url)
+                return;
+            reading_chapter_url.clear();
+        }
+        queue_cond.notify_all();
+    }
+
+    void SeriesDownloader::download_thread_func(int thread_index) {
+        std::unique_lock<std::mutex> lock(mutex);
+        while(running) {
+            auto next_chapter_it = queue.end();
+            queue_cond.wait(lock, [this, &next_chapter_it]() {
+                next_chapter_it = std::find_if(queue.begin(), queue.end(), [this](const QueuedChapter &queued_chapter) {
+                    return queued_chapter.chapter.url != reading_chapter_url;
+                });
+                return !running || next_chapter_it != queue.end();
+            });
+            if(!running)
+                break;
+
+            ActiveChapter &active_chapter = active_chapters[thread_index];
+            active_chapter.queued_chapter = std::move(*next_chapter_it);
+            active_chapter.active = true;
+            active_chapter.cancel = false;
+            queue.erase(next_chapter_it);
+            const QueuedChapter queued_chapter = active_chapter.queued_chapter;
+            lock.unlock();
+
+            const bool finished = download_chapter(thread_index, queued_chapter);
+
+            lock.lock();
+            active_chapter.active = false;
+            const std::string &chapter_url = queued_chapter.chapter.url;
+            if(finished) {
+                chapter_progress[chapter_url].state = ChapterDownloadState::FINISHED;
+            } else if(!running) {
+                queue.push_front(queued_chapter);
+            } else if(active_chapter.cancel) {
+                // The chapter is being read, it's downloaded by the image page instead
+                chapter_progress[chapter_url].state = ChapterDownloadState::QUEUED;
+                queue.push_back(queued_chapter);
+            } else {
+                fprintf(stderr, "Failed to download chapter \"%s\" (%s)\n", queued_chapter.chapter.title.c_str(), chapter_url.c_str());
+                chapter_progress[chapter_url].state = ChapterDownloadState::FAILED;
+                failed_chapters.push_back(queued_chapter);
+            }
+            save_queue(lock);
+
+            if(progress_callback) {
+                lock.unlock();
+                progress_callback();
+                lock.lock();
+            }
+        }
+    }
+
+    bool SeriesDownloader::download_chapter(int thread_index, const QueuedChapter &queued_chapter) {
+        const SeriesChapter &chapter = queued_chapter.chapter;
+        Path chapter_cache_dir = get_cache_dir().join("manga").join(queued_chapter.manga_id).join(chapter.dir);
+        if(create_directory_recursive(chapter_cache_dir) != 0) {
+            fprintf(stderr, "Failed to create directory: %s\n", chapter_cache_dir.data.c_str());
+            return false;
+        }
+
+        ChapterPack chapter_pack(chapter_cache_dir);
+        if(chapter_pack.is_complete())
+            return true;
+
+        // Also used when the chapter page is downloaded to find the pages, so the destructor doesn't wait for that download either
+        auto on_progress = [this, thread_index](size_t) {
+            std::lock_guard<std::mutex> lock(mutex);
+            return running && !active_chapters[thread_index].cancel;
+        };
+
+        int num_pages = 0;
+        if(plugin->get_number_of_images(chapter.url, num_pages, on_progress) != ImageResult::OK)
+            return false;
+        set_progress(chapter.url, ChapterDownloadState::DOWNLOADING, 0, num_pages);
+
+        int page_index = 0;
+        bool pages_downloaded = true;
+        ImageResult image_result = plugin->for_each_page_in_chapter(chapter.url, [&](const std::string &url) {
+            if(!on_progress(0)) {
+                pages_downloaded = false;
+                return false;
+            }
+
+            DownloadResult download_result = download_chapter_page(chapter_pack, chapter_cache_dir, page_index, plugin->get_page_mirror_urls(url), on_progress, download_args, plugin->use_tor, true);
+            if(download_result != DownloadResult::OK) {
+                pages_downloaded = false;
+                return false;
+            }
+
+            ++page_index;
+            if(manga_cache)
+                manga_cache->update_chapter_size(queued_chapter.manga_id, chapter.dir);
+            set_progress(chapter.url, ChapterDownloadState::DOWNLOADING, page_index, std::max(num_pages, page_index));
+            return true;
+        }, on_progress);
+
+        if(image_result != ImageResult::OK || !pages_downloaded)
+            return false;
+
+        chapter_pack.set_complete();
+        return true;
+    }
+
+    void SeriesDownloader::set_progress(const std::string &chapter_url, ChapterDownloadState state, int downloaded_pages, int num_pages) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            ChapterDownloadProgress &progress = chapter_progress[chapter_url];
+            progress.state = state;
+            progress.downloaded_pages = downloaded_pages;
+            progress.num_pages = num_pages;
+        }
+        if(progress_callback)
+            progress_callback();
+    }
+
+    static Json::Value chapter_to_json(const std::string &manga_id, const SeriesChapter &chapter) {
+        Json::Value json_chapter(Json::objectValue);
+        json_chapter["manga"] = manga_id;
+        json_chapter["title"] = chapter.title;
+        json_chapter["url"] = chapter.url;
+        json_chapter["dir"] = chapter.dir;
+        return json_chapter;
+    }
+
+    // Queue format: { "manga": { "<manga id>": "<manga name>" }, "chapters": [ { "manga", "title", "url", "dir" } ] }, in the order they are downloaded
+    void SeriesDownloader::load_queue() {
+        std::string file_content;
+        if(file_get_content(queue_path, file_content) != 0)
+            return;
+
+        Json::Value json_root;
+        Json::CharReaderBuilder json_builder;
+        std::unique_ptr<Json::CharReader> json_reader(json_builder.newCharReader());
+        std::string json_errors;
+        if(!json_reader->parse(file_content.data(), file_content.data() + file_content.size(), &json_root, &json_errors) || !json_root.isObject()) {
+            fprintf(stderr, "Failed to read the manga download queue, error: %s\n", json_errors.c_str());
+            return;
+        }
+
+        const Json::Value &json_manga = json_root["manga"];
+        if(json_manga.isObject()) {
+            for(auto it = json_manga.begin(); it != json_manga.end(); ++it) {
+                if(it->isString())
+                    manga_names[it.name()] = it->asString();
+            }
+        }
+
+        const Json::Value &json_chapters = json_root["chapters"];
+        if(!json_chapters.isArray())
+            return;
+
+        for(const Json::Value &json_chapter : json_chapters) {
+            if(!json_chapter.isObject())
+                continue;
+
+            const Json::Value &manga_id = json_chapter["manga"];
+            const Json::Value &title = json_chapter["title"];
+            const Json::Value &url = json_chapter["url"];
+            const Json::Value &dir = json_chapter["dir"];
+            if(!manga_id.isString() || !title.isString() || !url.isString() || !dir.isString() || chapter_progress.find(url.asString()) != chapter_progress.end())
+                continue;
+
+            chapter_progress[url.asString()] = ChapterDownloadProgress();
+            queue.push_back({ manga_id.asString(), { title.asString(), url.asString(), dir.asString() } });
+        }
+
+        if(!queue.empty())
+            fprintf(stderr, "Continuing the download of %zu manga chapters\n", queue.size());
+    }
+
+    void SeriesDownloader::save_queue(std::unique_lock<std::mutex> &lock) {
+        Json::Value json_chapters(Json::arrayValue);
+        std::unordered_map<std::string, bool> queued_manga;
+        auto append_chapter = [&](const QueuedChapter &queued_chapter) {
+            json_chapters.append(chapter_to_json(queued_chapter.manga_id, queued_chapter.chapter));
+            queued_manga[queued_chapter.manga_id] = true;
+        };
+
+        for(const ActiveChapter &active_chapter : active_chapters) {
+            if(active_chapter.active)
+                append_chapter(active_chapter.queued_chapter);
+        }
+        for(const QueuedChapter &queued_chapter : queue) {
+            append_chapter(queued_chapter);
+        }
+        for(const QueuedChapter &queued_chapter : failed_chapters) {
+            append_chapter(queued_chapter);
+        }
+
+        Json::Value json_manga(Json::objectValue);
+        for(auto &it : queued_manga) {
+            json_manga[it.first] = manga_names[it.first];
+        }
+
+        Json::Value json_root(Json::objectValue);
+        json_root["manga"] = std::move(json_manga);
+        json_root["chapters"] = std::move(json_chapters);
+        const uint64_t queue_version = ++queue_save_counter;
+        // The file is written without the lock, so the progress can be read while it's written
+        lock.unlock();
+        write_queue(json_root, queue_version);
+        lock.lock();
+    }
+
+    void SeriesDownloader::write_queue(const Json::Value &json_root, uint64_t queue_version) {
+        std::lock_guard<std::mutex> lock(save_mutex);
+        // A newer queue was saved by another thread while this thread waited for the lock
+        if(queue_version < saved_queue_version)
+            return;
+        saved_queue_version = queue_version;
+
+        Json::StreamWriterBuilder json_builder;
+        json_builder["indentation"] = "";
+        // Written to another file that replaces the queue, so the queue is not lost if the program is killed while it's written
+        Path tmp_queue_path = queue_path;
+        tmp_queue_path.data += ".tmp";
+        if(create_directory_recursive(get_storage_dir()) != 0
+            || file_overwrite(tmp_queue_path, Json::writeString(json_builder, json_root)) != 0
+            || rename(tmp_queue_path.data.c_str(), queue_path.data.c_str()) != 0)
+        {
+            fprintf(stderr, "Failed to save the manga download queue to %s\n", queue_path.data.c_str());
+        }
+    }
+}
@@ -1,7 +1,6 @@
 #include "../include/Storage.hpp"
 #include "../include/env.hpp"
 #include <stdio.h>
-#include <assert.h>
 
 #if OS_FAMILY == OS_FAMILY_POSIX
 #include <pwd.h>
@@ -89,7 +88,7 @@ namespace QuickMedia {
     }
 
     int file_get_content(const Path &path, std::string &result) {
-        assert(get_file_type(path) == FileType::REGULAR);
+        // Not asserted to be a regular file, since files can be renamed by other threads (downloads) after they have been checked
         FILE *file = fopen(path.data.c_str(), "rb");
         if(!file)
             return -errno;
@@ -105,6 +104,13 @@ namespace QuickMedia {
         return 0;
     }
 
+    long file_get_size(const Path &path) {
+        struct stat file_stat;
+        if(stat(path.data.c_str(), &file_stat) == 0 && S_ISREG(file_stat.st_mode))
+            return file_stat.st_size;
+        return -1;
+    }
+
     int file_overwrite(const Path &path, const std::string &data) {
         FILE *file = fopen(path.data.c_str(), "wb");
         if(!file)
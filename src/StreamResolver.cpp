@@ -0,0 +1,194 @@
+#include "../include/StreamResolver.hpp"
+#include "../include/Program.h"
+#include "../include/StringUtils.hpp"
+#include <SFML/System/Clock.hpp>
+#include <vector>
+#include <algorithm>
+#include <stdlib.h>
+#include <string.h>
+
+struct ResolveOutput {
+    std::string output;
+    const std::atomic<bool> *running;
+};
+
+static int accumulate_output(char *data, int size, void *userdata) {
+    ResolveOutput *resolve_output = (ResolveOutput*)userdata;
+    resolve_output->output.append(data, size);
+    return 0;
+}
+
+// youtube-dl doesn't write anything until it has resolved the stream, so it's killed from here when the resolver is destroyed
+static int check_resolve_cancelled(void *userdata) {
+    return !*((ResolveOutput*)userdata)->running;
+}
+
+namespace QuickMedia {
+    // Streams that don't say when they expire are assumed to be valid for this long
+    static const time_t DEFAULT_STREAM_LIFETIME_SEC = 60 * 30;
+    // The stream has to stay valid for a while after it has been loaded, so streams that expire soon are not used
+    static const time_t STREAM_EXPIRE_MARGIN_SEC = 60 * 5;
+    // Requests for videos that were highlighted a while ago are dropped, they are not likely to be played
+    static const size_t MAX_QUEUE_SIZE = 4;
+    // How often youtube-dl is checked for being cancelled while it's resolving
+    static const int RESOLVE_CANCEL_CHECK_INTERVAL_MS = 100;
+
+    // Youtube has the expire time in the query (expire=) or in the path (/expire/), pornhub has it in validto=
+    static time_t get_url_expire_time(const std::string &url) {
+        const char *keys[] = { "expire=", "/expire/", "validto=" };
+        for(const char *key : keys) {
+            size_t index = url.find(key);
+            if(index == std::string::npos)
+                continue;
+
+            const char *value = url.c_str() + index + strlen(key);
+            char *value_end = nullptr;
+            long long expire_time = strtoll(value, &value_end, 10);
+            if(value_end != value && expire_time > 0)
+                return expire_time;
+        }
+        return 0;
+    }
+
+    static bool resolve_stream(const std::string &url, bool use_tor, const std::atomic<bool> &running, ResolvedStream &result) {
+        sf::Clock timer;
+        std::vector<const char*> args;
+        if(use_tor)
+            args.push_back("torsocks");
+        // Same format as mpv uses by default when it runs youtube-dl
+        args.insert(args.end(), { "youtube-dl", "-g", "--no-playlist", "-f", "bestvideo+bestaudio/best", "--", url.c_str(), nullptr });
+
+        ResolveOutput resolve_output;
+        resolve_output.running = &running;
+        if(exec_program_cancellable(args.data(), accumulate_output, check_resolve_cancelled, RESOLVE_CANCEL_CHECK_INTERVAL_MS, &resolve_output) != 0) {
+            if(running)
+                fprintf(stderr, "Failed to resolve stream for %s\n", url.c_str());
+            return false;
+        }
+        const std::string &output = resolve_output.output;
+
+        // One line if the audio is in the video stream, otherwise the video stream followed by the audio stream
+        std::vector<std::string> stream_urls;
+        string_split(output, '\n', [&stream_urls](const char *str, size_t size) {
+            std::string stream_url = strip(std::string(str, size));
+            if(!stream_url.empty())
+                stream_urls.push_back(std::move(stream_url));
+            return true;
+        });
+
+        if(stream_urls.empty() || stream_urls.size() > 2) {
+            fprintf(stderr, "Unexpected youtube-dl output for %s: %s\n", url.c_str(), output.c_str());
+            return false;
+        }
+
+        result.video_url = stream_urls[0];
+        result.audio_url = stream_urls.size() == 2 ? stream_urls[1] : "";
+        result.expire_time = 0;
+        for(const std::string &stream_url : stream_urls) {
+            time_t expire_time = get_url_expire_time(stream_url);
+            if(expire_time != 0 && (result.expire_time == 0 || expire_time < result.expire_time))
+                result.expire_time = expire_time;
+        }
+        if(result.expire_time == 0)
+            result.expire_time = time(NULL) + DEFAULT_STREAM_LIFETIME_SEC;
+
+        fprintf(stderr, "Resolve duration for %s: %d ms\n", url.c_str(), timer.getElapsedTime().asMilliseconds());
+        return true;
+    }
+
+    StreamResolver::StreamResolver(bool use_tor, std::function<void()> resolved_callback) : use_tor(use_tor), resolved_callback(std::move(resolved_callback)), running(true) {
+        resolve_thread = std::thread(&StreamResolver::resolve_thread_func, this);
+    }
+
+    StreamResolver::~StreamResolver() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            running = false;
+        }
+        queue_cond.notify_all();
+        // youtube-dl is killed if it's running, so this doesn't wait until it has finished
+        resolve_thread.join();
+    }
+
+    void StreamResolver::request(const std::string &url) {
+        std::lock_guard<std::mutex> lock(mutex);
+        remove_expired_streams();
+
+        auto it = streams.find(url);
+        if(it != streams.end()) {
+            if(it->second.state == State::RESOLVING || it->second.state == State::RESOLVED)
+                return;
+
+            // Requested again, so it's resolved before the other queued urls
+            if(it->second.state == State::QUEUED)
+                queue.erase(std::find(queue.begin(), queue.end(), url));
+        }
+
+        streams[url].state = State::QUEUED;
+        queue.push_back(url);
+        if(queue.size() > MAX_QUEUE_SIZE) {
+            streams.erase(queue.front());
+            queue.pop_front();
+        }
+        queue_cond.notify_one();
+    }
+
+    StreamResolveResult StreamResolver::get(const std::string &url, ResolvedStream &result) {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = streams.find(url);
+        if(it == streams.end())
+            return StreamResolveResult::ERR;
+
+        switch(it->second.state) {
+            case State::QUEUED:
+            case State::RESOLVING:
+                return StreamResolveResult::IN_PROGRESS;
+            case State::RESOLVED:
+                if(it->second.resolved_stream.expire_time - STREAM_EXPIRE_MARGIN_SEC <= time(NULL))
+                    return StreamResolveResult::ERR;
+                result = it->second.resolved_stream;
+                return StreamResolveResult::OK;
+            case State::FAILED:
+                return StreamResolveResult::ERR;
+        }
+        return StreamResolveResult::ERR;
+    }
+
+    void StreamResolver::remove_expired_streams() {
+        const time_t now = time(NULL);
+        for(auto it = streams.begin(); it != streams.end();) {
+            if(it->second.state == State::RESOLVED && it->second.resolved_stream.expire_time - STREAM_EXPIRE_MARGIN_SEC <= now)
+                it = streams.erase(it);
+            else
+                ++it;
+        }
+    }
+
+    void StreamResolver::resolve_thread_func() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while(true) {
+            queue_cond.wait(lock, [this]() { return !running || !queue.empty(); });
+            if(!running)
+                break;
+
+            std::string url = std::move(queue.back());
+            queue.pop_back();
+            streams[url].state = State::RESOLVING;
+
+            lock.unlock();
+            ResolvedStream resolved_stream;
+            bool resolved = resolve_stream(url, use_tor, running, resolved_stream);
+            lock.lock();
+
+            Stream &stream = streams[url];
+            stream.state = resolved ? State::RESOLVED : State::FAILED;
+            stream.resolved_stream = std::move(resolved_stream);
+
+            if(resolved_callback) {
+                lock.unlock();
+                resolved_callback();
+                lock.lock();
+            }
+        }
+    }
+}
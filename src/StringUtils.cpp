@@ -1,5 +1,7 @@
 #include "../include/StringUtils.hpp"
 #include <string.h>
+#include <algorithm>
+#include <stdint.h>
 
 namespace QuickMedia {
     void string_split(const std::string &str, char delimiter, StringSplitCallback callback_func) {
@@ -53,4 +55,245 @@ namespace QuickMedia {
         size_t ends_len = ends_with_str.size();
         return ends_len == 0 || (str.size() >= ends_len && memcmp(&str[str.size() - ends_len], ends_with_str.data(), ends_len) == 0);
     }
+
+    static int hex_digit_value(char c) {
+        if(c >= '0' && c <= '9')
+            return c - '0';
+        if(c >= 'a' && c <= 'f')
+            return 10 + (c - 'a');
+        if(c >= 'A' && c <= 'F')
+            return 10 + (c - 'A');
+        return -1;
+    }
+
+    struct UrlUnreservedTable {
+        bool unreserved[256];
+
+        constexpr UrlUnreservedTable() : unreserved() {
+            for(int c = 0; c < 256; ++c)
+                unreserved[c] = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '-' || c == '_' || c == '.' || c == '~';
+        }
+    };
+
+    static constexpr UrlUnreservedTable url_unreserved_table;
+    static const char hex_digits_upper[] = "0123456789ABCDEF";
+
+    size_t url_param_encode(const char *str, size_t size, char *output) {
+        char *output_start = output;
+        for(size_t i = 0; i < size; ++i) {
+            const unsigned char c = str[i];
+            if(url_unreserved_table.unreserved[c]) {
+                *output++ = c;
+            } else {
+                output[0] = '%';
+                output[1] = hex_digits_upper[c >> 4];
+                output[2] = hex_digits_upper[c & 0xF];
+                output += 3;
+            }
+        }
+        return output - output_start;
+    }
+
+    void url_param_encode_append(const char *str, size_t size, std::string &result) {
+        const size_t prev_size = result.size();
+        result.resize(prev_size + size * 3);
+        const size_t encoded_size = url_param_encode(str, size, &result[prev_size]);
+        result.resize(prev_size + encoded_size);
+    }
+
+    std::string url_param_encode(const std::string &param) {
+        std::string result;
+        url_param_encode_append(param.data(), param.size(), result);
+        return result;
+    }
+
+    std::string url_param_decode(const std::string &param) {
+        std::string result;
+        result.resize(param.size());
+        size_t output_size = 0;
+        for(size_t i = 0; i < param.size(); ++i) {
+            if(param[i] == '%' && i + 2 < param.size()) {
+                const int high = hex_digit_value(param[i + 1]);
+                const int low = hex_digit_value(param[i + 2]);
+                if(high != -1 && low != -1) {
+                    result[output_size++] = (char)((high << 4) | low);
+                    i += 2;
+                    continue;
+                }
+            }
+            result[output_size++] = param[i];
+        }
+        result.resize(output_size);
+        return result;
+    }
+
+    void url_append_query_param(std::string &url, const char *key, const std::string &value) {
+        const size_t key_size = strlen(key);
+        url.reserve(url.size() + 2 + key_size + value.size() * 3);
+        url += url.find('?') == std::string::npos ? '?' : '&';
+        url.append(key, key_size);
+        url += '=';
+        url_param_encode_append(value.data(), value.size(), url);
+    }
+
+    struct HtmlNamedEntity {
+        const char *name;
+        uint32_t codepoint;
+    };
+
+    // All named character references in html 4 (and &apos;), sorted by name so they can be binary searched
+    static const HtmlNamedEntity html_named_entities[] = {
+        { "AElig", 0x00C6 }, { "Aacute", 0x00C1 }, { "Acirc", 0x00C2 }, { "Agrave", 0x00C0 }, { "Alpha", 0x0391 }, { "Aring", 0x00C5 },
+        { "Atilde", 0x00C3 }, { "Auml", 0x00C4 }, { "Beta", 0x0392 }, { "Ccedil", 0x00C7 }, { "Chi", 0x03A7 }, { "Dagger", 0x2021 },
+        { "Delta", 0x0394 }, { "ETH", 0x00D0 }, { "Eacute", 0x00C9 }, { "Ecirc", 0x00CA }, { "Egrave", 0x00C8 }, { "Epsilon", 0x0395 },
+        { "Eta", 0x0397 }, { "Euml", 0x00CB }, { "Gamma", 0x0393 }, { "Iacute", 0x00CD }, { "Icirc", 0x00CE }, { "Igrave", 0x00CC },
+        { "Iota", 0x0399 }, { "Iuml", 0x00CF }, { "Kappa", 0x039A }, { "Lambda", 0x039B }, { "Mu", 0x039C }, { "Ntilde", 0x00D1 }, { "Nu", 0x039D },
+        { "OElig", 0x0152 }, { "Oacute", 0x00D3 }, { "Ocirc", 0x00D4 }, { "Ograve", 0x00D2 }, { "Omega", 0x03A9 }, { "Omicron", 0x039F },
+        { "Oslash", 0x00D8 }, { "Otilde", 0x00D5 }, { "Ouml", 0x00D6 }, { "Phi", 0x03A6 }, { "Pi", 0x03A0 }, { "Prime", 0x2033 }, { "Psi", 0x03A8 },
+        { "Rho", 0x03A1 }, { "Scaron", 0x0160 }, { "Sigma", 0x03A3 }, { "THORN", 0x00DE }, { "Tau", 0x03A4 }, { "Theta", 0x0398 },
+        { "Uacute", 0x00DA }, { "Ucirc", 0x00DB }, { "Ugrave", 0x00D9 }, { "Upsilon", 0x03A5 }, { "Uuml", 0x00DC }, { "Xi", 0x039E },
+        { "Yacute", 0x00DD }, { "Yuml", 0x0178 }, { "Zeta", 0x0396 }, { "aacute", 0x00E1 }, { "acirc", 0x00E2 }, { "acute", 0x00B4 },
+        { "aelig", 0x00E6 }, { "agrave", 0x00E0 }, { "alefsym", 0x2135 }, { "alpha", 0x03B1 }, { "amp", 0x0026 }, { "and", 0x2227 },
+        { "ang", 0x2220 }, { "apos", 0x0027 }, { "aring", 0x00E5 }, { "asymp", 0x2248 }, { "atilde", 0x00E3 }, { "auml", 0x00E4 },
+        { "bdquo", 0x201E }, { "beta", 0x03B2 }, { "brvbar", 0x00A6 }, { "bull", 0x2022 }, { "cap", 0x2229 }, { "ccedil", 0x00E7 },
+        { "cedil", 0x00B8 }, { "cent", 0x00A2 }, { "chi", 0x03C7 }, { "circ", 0x02C6 }, { "clubs", 0x2663 }, { "cong", 0x2245 }, { "copy", 0x00A9 },
+        { "crarr", 0x21B5 }, { "cup", 0x222A }, { "curren", 0x00A4 }, { "dArr", 0x21D3 }, { "dagger", 0x2020 }, { "darr", 0x2193 },
+        { "deg", 0x00B0 }, { "delta", 0x03B4 }, { "diams", 0x2666 }, { "divide", 0x00F7 }, { "eacute", 0x00E9 }, { "ecirc", 0x00EA },
+        { "egrave", 0x00E8 }, { "empty", 0x2205 }, { "emsp", 0x2003 }, { "ensp", 0x2002 }, { "epsilon", 0x03B5 }, { "equiv", 0x2261 },
+        { "eta", 0x03B7 }, { "eth", 0x00F0 }, { "euml", 0x00EB }, { "euro", 0x20AC }, { "exist", 0x2203 }, { "fnof", 0x0192 }, { "forall", 0x2200 },
+        { "frac12", 0x00BD }, { "frac14", 0x00BC }, { "frac34", 0x00BE }, { "frasl", 0x2044 }, { "gamma", 0x03B3 }, { "ge", 0x2265 },
+        { "gt", 0x003E }, { "hArr", 0x21D4 }, { "harr", 0x2194 }, { "hearts", 0x2665 }, { "hellip", 0x2026 }, { "iacute", 0x00ED },
+        { "icirc", 0x00EE }, { "iexcl", 0x00A1 }, { "igrave", 0x00EC }, { "image", 0x2111 }, { "infin", 0x221E }, { "int", 0x222B },
+        { "iota", 0x03B9 }, { "iquest", 0x00BF }, { "isin", 0x2208 }, { "iuml", 0x00EF }, { "kappa", 0x03BA }, { "lArr", 0x21D0 },
+        { "lambda", 0x03BB }, { "lang", 0x2329 }, { "laquo", 0x00AB }, { "larr", 0x2190 }, { "lceil", 0x2308 }, { "ldquo", 0x201C },
+        { "le", 0x2264 }, { "lfloor", 0x230A }, { "lowast", 0x2217 }, { "loz", 0x25CA }, { "lrm", 0x200E }, { "lsaquo", 0x2039 },
+        { "lsquo", 0x2018 }, { "lt", 0x003C }, { "macr", 0x00AF }, { "mdash", 0x2014 }, { "micro", 0x00B5 }, { "middot", 0x00B7 },
+        { "minus", 0x2212 }, { "mu", 0x03BC }, { "nabla", 0x2207 }, { "nbsp", 0x00A0 }, { "ndash", 0x2013 }, { "ne", 0x2260 }, { "ni", 0x220B },
+        { "not", 0x00AC }, { "notin", 0x2209 }, { "nsub", 0x2284 }, { "ntilde", 0x00F1 }, { "nu", 0x03BD }, { "oacute", 0x00F3 },
+        { "ocirc", 0x00F4 }, { "oelig", 0x0153 }, { "ograve", 0x00F2 }, { "oline", 0x203E }, { "omega", 0x03C9 }, { "omicron", 0x03BF },
+        { "oplus", 0x2295 }, { "or", 0x2228 }, { "ordf", 0x00AA }, { "ordm", 0x00BA }, { "oslash", 0x00F8 }, { "otilde", 0x00F5 },
+        { "otimes", 0x2297 }, { "ouml", 0x00F6 }, { "para", 0x00B6 }, { "part", 0x2202 }, { "permil", 0x2030 }, { "perp", 0x22A5 },
+        { "phi", 0x03C6 }, { "pi", 0x03C0 }, { "piv", 0x03D6 }, { "plusmn", 0x00B1 }, { "pound", 0x00A3 }, { "prime", 0x2032 }, { "prod", 0x220F },
+        { "prop", 0x221D }, { "psi", 0x03C8 }, { "quot", 0x0022 }, { "rArr", 0x21D2 }, { "radic", 0x221A }, { "rang", 0x232A }, { "raquo", 0x00BB },
+        { "rarr", 0x2192 }, { "rceil", 0x2309 }, { "rdquo", 0x201D }, { "real", 0x211C }, { "reg", 0x00AE }, { "rfloor", 0x230B }, { "rho", 0x03C1 },
+        { "rlm", 0x200F }, { "rsaquo", 0x203A }, { "rsquo", 0x2019 }, { "sbquo", 0x201A }, { "scaron", 0x0161 }, { "sdot", 0x22C5 },
+        { "sect", 0x00A7 }, { "shy", 0x00AD }, { "sigma", 0x03C3 }, { "sigmaf", 0x03C2 }, { "sim", 0x223C }, { "spades", 0x2660 }, { "sub", 0x2282 },
+        { "sube", 0x2286 }, { "sum", 0x2211 }, { "sup", 0x2283 }, { "sup1", 0x00B9 }, { "sup2", 0x00B2 }, { "sup3", 0x00B3 }, { "supe", 0x2287 },
+        { "szlig", 0x00DF }, { "tau", 0x03C4 }, { "there4", 0x2234 }, { "theta", 0x03B8 }, { "thetasym", 0x03D1 }, { "thinsp", 0x2009 },
+        { "thorn", 0x00FE }, { "tilde", 0x02DC }, { "times", 0x00D7 }, { "trade", 0x2122 }, { "uArr", 0x21D1 }, { "uacute", 0x00FA },
+        { "uarr", 0x2191 }, { "ucirc", 0x00FB }, { "ugrave", 0x00F9 }, { "uml", 0x00A8 }, { "upsih", 0x03D2 }, { "upsilon", 0x03C5 },
+        { "uuml", 0x00FC }, { "weierp", 0x2118 }, { "xi", 0x03BE }, { "yacute", 0x00FD }, { "yen", 0x00A5 }, { "yuml", 0x00FF }, { "zeta", 0x03B6 },
+        { "zwj", 0x200D }, { "zwnj", 0x200C }
+    };
+
+    static const size_t html_named_entity_max_length = 8;
+
+    static bool html_named_entity_find(const char *name, size_t name_length, uint32_t &codepoint) {
+        if(name_length == 0 || name_length > html_named_entity_max_length)
+            return false;
+
+        auto begin = std::begin(html_named_entities);
+        auto end = std::end(html_named_entities);
+        auto it = std::lower_bound(begin, end, name, [name_length](const HtmlNamedEntity &entity, const char *name) {
+            return strncmp(entity.name, name, name_length) < 0;
+        });
+        if(it == end || strncmp(it->name, name, name_length) != 0 || it->name[name_length] != '\0')
+            return false;
+
+        codepoint = it->codepoint;
+        return true;
+    }
+
+    // Returns the number of bytes written to @output, which needs to have room for 4 bytes
+    static size_t codepoint_to_utf8(uint32_t codepoint, char *output) {
+        if(codepoint == 0 || codepoint > 0x10FFFF || (codepoint >= 0xD800 && codepoint <= 0xDFFF))
+            codepoint = 0xFFFD; // Replacement character
+
+        if(codepoint <= 0x7F) {
+            output[0] = codepoint;
+            return 1;
+        } else if(codepoint <= 0x7FF) {
+            output[0] = 0xC0 | (codepoint >> 6);
+            output[1] = 0x80 | (codepoint & 0x3F);
+            return 2;
+        } else if(codepoint <= 0xFFFF) {
+            output[0] = 0xE0 | (codepoint >> 12);
+            output[1] = 0x80 | ((codepoint >> 6) & 0x3F);
+            output[2] = 0x80 | (codepoint & 0x3F);
+            return 3;
+        } else {
+            output[0] = 0xF0 | (codepoint >> 18);
+            output[1] = 0x80 | ((codepoint >> 12) & 0x3F);
+            output[2] = 0x80 | ((codepoint >> 6) & 0x3F);
+            output[3] = 0x80 | (codepoint & 0x3F);
+            return 4;
+        }
+    }
+
+    // @str points to the character after '&' and @end is the end of the string.
+    // Returns the length of the reference (excluding '&' but including ';') or 0 if it's not a valid reference
+    static size_t html_parse_character_reference(const char *str, const char *end, uint32_t &codepoint) {
+        const char *semicolon = (const char*)memchr(str, ';', std::min((size_t)(end - str), html_named_entity_max_length + 2));
+        if(!semicolon)
+            return 0;
+
+        const size_t length = semicolon - str;
+        if(length >= 2 && str[0] == '#') {
+            const bool hex = str[1] == 'x' || str[1] == 'X';
+            const char *digits = str + (hex ? 2 : 1);
+            if(digits == semicolon)
+                return 0;
+
+            uint32_t value = 0;
+            for(const char *c = digits; c != semicolon; ++c) {
+                int digit = hex ? hex_digit_value(*c) : (*c >= '0' && *c <= '9' ? *c - '0' : -1);
+                if(digit == -1)
+                    return 0;
+                value = value * (hex ? 16 : 10) + digit;
+            }
+            codepoint = value;
+            return length + 1;
+        }
+
+        if(html_named_entity_find(str, length, codepoint))
+            return length + 1;
+        return 0;
+    }
+
+    // Decoding is done in place. This is safe because the utf8 encoding of a character reference
+    // is never longer than the reference itself
+    void html_unescape_sequences(std::string &str) {
+        if(str.empty())
+            return;
+
+        char *data = &str[0];
+        const char *end = data + str.size();
+        const char *read_ptr = (const char*)memchr(data, '&', str.size());
+        if(!read_ptr)
+            return;
+
+        char *write_ptr = data + (read_ptr - data);
+        while(read_ptr != end) {
+            if(*read_ptr != '&') {
+                const char *next_amp = (const char*)memchr(read_ptr, '&', end - read_ptr);
+                const char *copy_end = next_amp ? next_amp : end;
+                memmove(write_ptr, read_ptr, copy_end - read_ptr);
+                write_ptr += (copy_end - read_ptr);
+                read_ptr = copy_end;
+                continue;
+            }
+
+            uint32_t codepoint = 0;
+            size_t reference_length = html_parse_character_reference(read_ptr + 1, end, codepoint);
+            if(reference_length == 0) {
+                *write_ptr++ = *read_ptr++;
+                continue;
+            }
+
+            write_ptr += codepoint_to_utf8(codepoint, write_ptr);
+            read_ptr += 1 + reference_length;
+        }
+
+        str.resize(write_ptr - data);
+    }
 }
\ No newline at end of file
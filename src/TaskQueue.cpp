@@ -0,0 +1,47 @@
+#include "../include/TaskQueue.hpp"
+#include <stdexcept>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <stdint.h>
+#include <stdio.h>
+
+namespace QuickMedia {
+    TaskQueue::TaskQueue() {
+        event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if(event_fd == -1)
+            throw std::runtime_error("Failed to create eventfd for the task queue");
+    }
+
+    TaskQueue::~TaskQueue() {
+        close(event_fd);
+    }
+
+    void TaskQueue::post(Task task) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            tasks.push_back(std::move(task));
+        }
+        uint64_t value = 1;
+        if(write(event_fd, &value, sizeof(value)) != sizeof(value))
+            perror("Failed to wake up the main thread");
+    }
+
+    int TaskQueue::run_tasks() {
+        // Reset the eventfd before taking the tasks, so a task that is posted while the tasks are running wakes up the main thread again
+        uint64_t value;
+        if(read(event_fd, &value, sizeof(value)) != sizeof(value))
+            return 0;
+
+        std::vector<Task> tasks_to_run;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            tasks_to_run.swap(tasks);
+        }
+
+        for(Task &task : tasks_to_run) {
+            if(task)
+                task();
+        }
+        return tasks_to_run.size();
+    }
+}
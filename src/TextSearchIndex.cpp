@@ -0,0 +1,209 @@
+#include "../include/TextSearchIndex.hpp"
+#include <algorithm>
+#include <functional>
+#include <cmath>
+#include <assert.h>
+
+namespace QuickMedia {
+    // Bytes that are not ascii (utf8 sequences) are part of words as well, so non-english text can also be searched
+    static bool is_word_char(unsigned char c) {
+        return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c >= 128;
+    }
+
+    static char to_lower(char c) {
+        if(c >= 'A' && c <= 'Z')
+            return c + 32;
+        return c;
+    }
+
+    using WordCallback = std::function<void(std::string &word)>;
+    static void for_each_word(const std::string &text, const WordCallback &callback) {
+        std::string word;
+        for(char c : text) {
+            if(is_word_char(c)) {
+                word += to_lower(c);
+            } else if(!word.empty()) {
+                callback(word);
+                word.clear();
+            }
+        }
+        if(!word.empty())
+            callback(word);
+    }
+
+    void TextSearchIndex::begin_update() {
+        ++update_generation;
+    }
+
+    void TextSearchIndex::end_update() {
+        for(uint32_t i = 0; i < documents.size(); ++i) {
+            if(documents[i].alive && documents[i].update_generation != update_generation)
+                remove_document_by_index(i);
+        }
+    }
+
+    bool TextSearchIndex::keep_document(const std::string &document_id, int64_t revision) {
+        auto it = document_index_by_id.find(document_id);
+        if(it == document_index_by_id.end())
+            return false;
+
+        Document &document = documents[it->second];
+        if(document.revision != revision)
+            return false;
+
+        document.update_generation = update_generation;
+        return true;
+    }
+
+    void TextSearchIndex::update_document(const std::string &document_id, const std::string &text, int64_t revision) {
+        remove_document(document_id);
+
+        uint32_t document_index;
+        if(free_document_indices.empty()) {
+            document_index = documents.size();
+            documents.emplace_back();
+        } else {
+            document_index = free_document_indices.back();
+            free_document_indices.pop_back();
+        }
+
+        std::unordered_map<std::string, uint32_t> term_frequencies;
+        uint32_t num_words = 0;
+        for_each_word(text, [&term_frequencies, &num_words](std::string &word) {
+            ++term_frequencies[word];
+            ++num_words;
+        });
+
+        Document &document = documents[document_index];
+        document.id = document_id;
+        document.revision = revision;
+        document.num_words = num_words;
+        document.update_generation = update_generation;
+        document.alive = true;
+        document.words.clear();
+        document.words.reserve(term_frequencies.size());
+        for(auto &term_frequency : term_frequencies) {
+            postings_by_word[term_frequency.first].push_back({ document_index, term_frequency.second });
+            document.words.push_back(term_frequency.first);
+        }
+
+        document_index_by_id[document_id] = document_index;
+        ++num_alive_documents;
+        total_num_words += num_words;
+    }
+
+    void TextSearchIndex::remove_document(const std::string &document_id) {
+        auto it = document_index_by_id.find(document_id);
+        if(it != document_index_by_id.end())
+            remove_document_by_index(it->second);
+    }
+
+    void TextSearchIndex::remove_document_by_index(uint32_t document_index) {
+        Document &document = documents[document_index];
+        assert(document.alive);
+        for(const std::string &word : document.words) {
+            auto postings_it = postings_by_word.find(word);
+            if(postings_it == postings_by_word.end())
+                continue;
+
+            std::vector<Posting> &postings = postings_it->second;
+            postings.erase(std::remove_if(postings.begin(), postings.end(), [document_index](const Posting &posting) {
+                return posting.document_index == document_index;
+            }), postings.end());
+
+            if(postings.empty())
+                postings_by_word.erase(postings_it);
+        }
+
+        document_index_by_id.erase(document.id);
+        --num_alive_documents;
+        total_num_words -= document.num_words;
+        document.alive = false;
+        document.id.clear();
+        document.words.clear();
+        free_document_indices.push_back(document_index);
+    }
+
+    void TextSearchIndex::clear() {
+        documents.clear();
+        free_document_indices.clear();
+        document_index_by_id.clear();
+        postings_by_word.clear();
+        num_alive_documents = 0;
+        total_num_words = 0;
+    }
+
+    // Okapi BM25
+    float TextSearchIndex::score(const Posting &posting, size_t document_frequency) const {
+        const float k1 = 1.2f;
+        const float b = 0.75f;
+        const float average_num_words = num_alive_documents == 0 ? 1.0f : (float)total_num_words / (float)num_alive_documents;
+        const float idf = std::log(1.0f + ((float)num_alive_documents - (float)document_frequency + 0.5f) / ((float)document_frequency + 0.5f));
+        const float tf = posting.term_frequency;
+        const float document_length_ratio = (float)documents[posting.document_index].num_words / std::max(1.0f, average_num_words);
+        return idf * (tf * (k1 + 1.0f)) / (tf + k1 * (1.0f - b + b * document_length_ratio));
+    }
+
+    std::vector<TextSearchMatch> TextSearchIndex::search(const std::string &query, size_t max_results) const {
+        std::vector<TextSearchMatch> result;
+
+        std::vector<std::string> query_words;
+        for_each_word(query, [&query_words](std::string &word) {
+            if(std::find(query_words.begin(), query_words.end(), word) == query_words.end())
+                query_words.push_back(word);
+        });
+
+        if(query_words.empty())
+            return result;
+
+        std::vector<float> document_scores(documents.size(), 0.0f);
+        // Number of query words each document has matched so far. A document has to match all of them
+        std::vector<uint32_t> document_num_matches(documents.size(), 0);
+
+        for(uint32_t i = 0; i < query_words.size() - 1; ++i) {
+            auto postings_it = postings_by_word.find(query_words[i]);
+            if(postings_it == postings_by_word.end())
+                return result;
+
+            const std::vector<Posting> &postings = postings_it->second;
+            for(const Posting &posting : postings) {
+                if(document_num_matches[posting.document_index] != i)
+                    continue;
+                document_num_matches[posting.document_index] = i + 1;
+                document_scores[posting.document_index] += score(posting, postings.size());
+            }
+        }
+
+        const uint32_t num_full_words = query_words.size() - 1;
+        const std::string &prefix = query_words.back();
+        // Only the best word that begins with the prefix counts for a document, otherwise short prefixes would favor long comments
+        std::unordered_map<uint32_t, float> prefix_scores;
+        for(auto it = postings_by_word.lower_bound(prefix), end = postings_by_word.end(); it != end; ++it) {
+            if(it->first.compare(0, prefix.size(), prefix) != 0)
+                break;
+
+            // Exact matches are better than words that only begin with the prefix
+            const float prefix_penalty = it->first.size() == prefix.size() ? 1.0f : 0.5f;
+            for(const Posting &posting : it->second) {
+                if(document_num_matches[posting.document_index] != num_full_words)
+                    continue;
+                float &prefix_score = prefix_scores[posting.document_index];
+                prefix_score = std::max(prefix_score, score(posting, it->second.size()) * prefix_penalty);
+            }
+        }
+
+        result.reserve(prefix_scores.size());
+        for(auto &prefix_score : prefix_scores) {
+            const Document &document = documents[prefix_score.first];
+            result.push_back({ document.id, document_scores[prefix_score.first] + prefix_score.second });
+        }
+
+        std::sort(result.begin(), result.end(), [](const TextSearchMatch &match1, const TextSearchMatch &match2) {
+            return match1.score > match2.score;
+        });
+
+        if(max_results != 0 && result.size() > max_results)
+            result.resize(max_results);
+        return result;
+    }
+}
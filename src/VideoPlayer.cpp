@@ -11,29 +11,37 @@
 #include <unistd.h>
 #include <fcntl.h>
 #include <signal.h>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <sys/wait.h>
 
-const int RETRY_TIME_MS = 1000;
-const int MAX_RETRIES_CONNECT = 5;
-const int READ_TIMEOUT_MS = 200;
+const int CONNECT_TIMEOUT_MS = 5000;
+const int FIND_WINDOW_TIMEOUT_MS = 10000;
+const int FIND_WINDOW_TIMEOUT_TOR_MS = 30000;
+const int READ_TIMEOUT_MS = 1000;
+const size_t READ_CHUNK_SIZE = 4096;
 
 namespace QuickMedia {
     VideoPlayer::VideoPlayer(bool use_tor, EventCallbackFunc _event_callback, VideoPlayerWindowCreateCallback _window_create_callback) :
         use_tor(use_tor),
         video_process_id(-1),
         ipc_socket(-1),
+        inotify_fd(-1),
         connected_to_ipc(false),
-        connect_tries(0),
-        find_window_tries(0),
+        ipc_server_created(false),
+        video_requested(false),
         event_callback(_event_callback),
         window_create_callback(_window_create_callback),
         window_handle(0),
         parent_window(0),
         display(nullptr),
         request_id(1),
-        expected_request_id(0),
-        request_response_data(Json::nullValue),
-        response_data_status(ResponseDataStatus::NONE)
+        read_buffer_begin(0),
+        read_buffer_end(0)
     {
+        Json::CharReaderBuilder json_builder;
+        json_reader.reset(json_builder.newCharReader());
+
         display = XOpenDisplay(NULL);
         if (!display)
             throw std::runtime_error("Failed to open display to X11 server");
@@ -47,7 +55,10 @@ namespace QuickMedia {
 
         if(ipc_socket != -1)
             close(ipc_socket);
-        
+
+        if(inotify_fd != -1)
+            close(inotify_fd);
+
         if(video_process_id != -1)
             remove(ipc_server_path);
 
@@ -55,14 +66,56 @@ namespace QuickMedia {
             XCloseDisplay(display);
     }
 
-    VideoPlayer::Error VideoPlayer::launch_video_process(const char *path, sf::WindowHandle _parent_window) {
+    void VideoPlayer::terminate_process() {
+        // The process may have been reaped already by the check in |start|, in which case the pid can't be killed anymore
+        if(video_process_id != -1 && waitpid(video_process_id, nullptr, WNOHANG) == 0) {
+            kill(video_process_id, SIGTERM);
+            wait_program(video_process_id);
+        }
+        video_process_id = -1;
+        remove(ipc_server_path);
+
+        disconnect();
+        if(inotify_fd != -1) {
+            close(inotify_fd);
+            inotify_fd = -1;
+        }
+        ipc_server_created = false;
+        video_requested = false;
+        window_handle = 0;
+        playback_state = PlaybackState();
+    }
+
+    VideoPlayer::Error VideoPlayer::start(sf::WindowHandle _parent_window) {
+        // This check is to make sure we dont change window that the video belongs to. This is not a usecase we will have so
+        // no need to support it for not at least.
+        assert(parent_window == 0 || parent_window == _parent_window);
+        if(video_process_id != -1) {
+            // The idle mpv is reused unless it has exited (crashed or was killed) or closed the ipc socket while waiting for the next video
+            if(ipc_socket != -1 && waitpid(video_process_id, nullptr, WNOHANG) == 0)
+                return Error::OK;
+            fprintf(stderr, "mpv is not running anymore, launching it again\n");
+            terminate_process();
+        }
+
         parent_window = _parent_window;
+        // To be notified when mpv maps its window inside the parent window
+        XSelectInput(display, parent_window, SubstructureNotifyMask);
+        XFlush(display);
 
         if(!tmpnam(ipc_server_path)) {
             perror("Failed to generate ipc file name");
             return Error::FAIL_TO_GENERATE_IPC_FILENAME;
         }
 
+        // The directory is watched before mpv is launched, so the creation of the ipc socket can't be missed
+        std::string ipc_server_dir = ipc_server_path;
+        size_t dir_end = ipc_server_dir.rfind('/');
+        ipc_server_dir = dir_end == std::string::npos ? "." : ipc_server_dir.substr(0, dir_end);
+        inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if(inotify_fd == -1 || inotify_add_watch(inotify_fd, ipc_server_dir.c_str(), IN_CREATE) == -1)
+            perror("Failed to watch the mpv ipc socket directory, falling back to trying to connect every update");
+
         const std::string parent_window_str = std::to_string(parent_window);
         std::vector<const char*> args;
         if(use_tor)
@@ -73,14 +126,16 @@ namespace QuickMedia {
         std::string wid_arg = "--wid=";
         wid_arg += parent_window_str;
 
-        args.insert(args.end(), { "mpv", "--keep-open=yes", /*"--keep-open-pause=no",*/ input_ipc_server_arg.c_str(),
+        // mpv is idle until a video is loaded and it only creates its window while playing a video
+        args.insert(args.end(), { "mpv", "--idle=yes", "--keep-open=yes", /*"--keep-open-pause=no",*/ input_ipc_server_arg.c_str(),
             "--no-config", "--no-input-default-bindings", "--input-vo-keyboard=no", "--no-input-cursor",
             "--cache-secs=120", "--demuxer-max-bytes=40M", "--demuxer-max-back-bytes=20M",
+            "--prefetch-playlist=yes",
             "--no-input-terminal",
             "--no-osc",
             "--profile=gpu-hq",
             /*"--vo=gpu", "--hwdec=auto",*/
-            wid_arg.c_str(), "--", path, nullptr });
+            wid_arg.c_str(), nullptr });
         if(exec_program_async(args.data(), &video_process_id) != 0)
             return Error::FAIL_TO_LAUNCH_PROCESS;
 
@@ -97,19 +152,50 @@ namespace QuickMedia {
         int flags = fcntl(ipc_socket, F_GETFL, 0);
         fcntl(ipc_socket, F_SETFL, flags | O_NONBLOCK);
 
+        connect_timer.restart();
         return Error::OK;
     }
 
-    VideoPlayer::Error VideoPlayer::load_video(const char *path, sf::WindowHandle _parent_window) {
-        // This check is to make sure we dont change window that the video belongs to. This is not a usecase we will have so
-        // no need to support it for not at least.
-        assert(parent_window == 0 || parent_window == _parent_window);
-        if(video_process_id == -1)
-            return launch_video_process(path, _parent_window);
+    VideoPlayer::Error VideoPlayer::load_video(const char *path, sf::WindowHandle _parent_window, const char *audio_path) {
+        Error err = start(_parent_window);
+        if(err != Error::OK)
+            return err;
 
-        Json::Value command_data(Json::arrayValue);
-        command_data.append("loadfile");
-        command_data.append(path);
+        // Find the window of mpv again, it may have been recreated
+        if(!video_requested) {
+            video_requested = true;
+            window_handle = 0;
+            find_window_timer.restart();
+        }
+        return send_loadfile_command(path, "replace", audio_path);
+    }
+
+    VideoPlayer::Error VideoPlayer::stop() {
+        if(!video_requested)
+            return Error::OK;
+
+        // mpv destroys its window when it stops playing, until the next video is loaded
+        video_requested = false;
+        window_handle = 0;
+        playback_state = PlaybackState();
+        const char cmd[] = "stop\n";
+        return send_command(cmd, sizeof(cmd) - 1);
+    }
+
+    VideoPlayer::Error VideoPlayer::append_video(const char *path, const char *audio_path) {
+        return send_loadfile_command(path, "append", audio_path);
+    }
+
+    VideoPlayer::Error VideoPlayer::send_loadfile_command(const char *path, const char *mode, const char *audio_path) {
+        // Named arguments, since the position of the options argument depends on the version of mpv
+        Json::Value command_data(Json::objectValue);
+        command_data["name"] = "loadfile";
+        command_data["url"] = path;
+        command_data["flags"] = mode;
+        if(audio_path) {
+            // %length% quotes the value, urls can contain commas which would otherwise separate options
+            command_data["options"] = "audio-file=%" + std::to_string(strlen(audio_path)) + "%" + audio_path;
+        }
         Json::Value command(Json::objectValue);
         command["command"] = command_data;
 
@@ -120,144 +206,291 @@ namespace QuickMedia {
         return send_command(cmd_str.c_str(), cmd_str.size());
     }
 
-    static std::vector<Window> get_child_window(Display *display, Window window) {
-        std::vector<Window> result;
-        Window root_window;
-        Window parent_window;
-        Window *child_window;
-        unsigned int num_children;
-        if(XQueryTree(display, window, &root_window, &parent_window, &child_window, &num_children) != 0) {
-            for(unsigned int i = 0; i < num_children; i++)
-                result.push_back(child_window[i]);
-        }
-        return result;
-    }
-
     VideoPlayer::Error VideoPlayer::update() {
-        int max_retries_find_window = 10;
-        if(use_tor)
-            max_retries_find_window = 30;
-
         if(ipc_socket == -1)
             return Error::INIT_FAILED;
 
-        if(connect_tries == MAX_RETRIES_CONNECT)
-            return Error::FAIL_TO_CONNECT_TIMEOUT;
+        if(!connected_to_ipc) {
+            Error err = try_connect();
+            if(err != Error::OK)
+                return err;
+        }
 
-        if(find_window_tries == max_retries_find_window)
-            return Error::FAIL_TO_FIND_WINDOW;
+        // mpv creates its window as a child of the parent window when it starts playing a video and destroys it when it stops
+        while(XPending(display)) {
+            XEvent xev;
+            XNextEvent(display, &xev);
+            if(xev.type == MapNotify && xev.xmap.event == parent_window && video_requested && window_handle == 0) {
+                window_handle = xev.xmap.window;
+                if(window_create_callback)
+                    window_create_callback(window_handle);
+            } else if(xev.type == DestroyNotify && xev.xdestroywindow.window == window_handle) {
+                window_handle = 0;
+            }
+        }
 
-        if(!connected_to_ipc && retry_timer.getElapsedTime().asMilliseconds() >= RETRY_TIME_MS) {
-            retry_timer.restart();
-            if(connect(ipc_socket, (struct sockaddr*)&ipc_addr, sizeof(ipc_addr)) == -1) {
-                ++connect_tries;
-                if(connect_tries == MAX_RETRIES_CONNECT) {
-                    fprintf(stderr, "Failed to connect to mpv ipc after %d seconds, last error: %s\n", (RETRY_TIME_MS * MAX_RETRIES_CONNECT)/1000, strerror(errno));
-                    return Error::FAIL_TO_CONNECT_TIMEOUT;
-                }
-            } else {
-                connected_to_ipc = true;
+        const int find_window_timeout_ms = use_tor ? FIND_WINDOW_TIMEOUT_TOR_MS : FIND_WINDOW_TIMEOUT_MS;
+        if(video_requested && window_handle == 0 && find_window_timer.getElapsedTime().asMilliseconds() >= find_window_timeout_ms) {
+            fprintf(stderr, "Failed to find mpv window after %d seconds\n", find_window_timeout_ms / 1000);
+            return Error::FAIL_TO_FIND_WINDOW_TIMEOUT;
+        }
+
+        if(connected_to_ipc) {
+            struct pollfd poll_fd = { ipc_socket, POLLIN, 0 };
+            if(poll(&poll_fd, 1, 0) > 0) {
+                Error err = read_ipc_func();
+                if(err != Error::OK)
+                    return err;
             }
+            remove_timed_out_requests();
         }
 
-        if(connected_to_ipc && window_handle == 0 && retry_timer.getElapsedTime().asMilliseconds() >= RETRY_TIME_MS) {
-            retry_timer.restart();
-            std::vector<Window> child_windows = get_child_window(display, parent_window);
-            size_t num_children = child_windows.size();
-            if(num_children == 0) {
-                ++find_window_tries;
-                if(find_window_tries == max_retries_find_window) {
-                    fprintf(stderr, "Failed to find mpv window after %d seconds\n", (RETRY_TIME_MS * max_retries_find_window)/1000);
-                    return Error::FAIL_TO_FIND_WINDOW_TIMEOUT;
-                }
-            } else if(num_children == 1) {
-                window_handle = child_windows[0];
-                if(window_create_callback)
-                    window_create_callback(window_handle);
-            } else {
-                fprintf(stderr, "Expected window to have one child (the video player) but it has %zu\n", num_children);
-                return Error::UNEXPECTED_WINDOW_ERROR;
+        return Error::OK;
+    }
+
+    bool VideoPlayer::ipc_server_created_event() {
+        // Enough for several events with the file name of the socket
+        alignas(struct inotify_event) char buffer[4096];
+        bool created = false;
+        while(true) {
+            ssize_t bytes_read = read(inotify_fd, buffer, sizeof(buffer));
+            if(bytes_read <= 0)
+                break;
+
+            const char *ipc_server_filename = strrchr(ipc_server_path, '/');
+            ipc_server_filename = ipc_server_filename ? ipc_server_filename + 1 : ipc_server_path;
+            for(ssize_t i = 0; i < bytes_read;) {
+                const struct inotify_event *event = (const struct inotify_event*)(buffer + i);
+                if(event->len > 0 && strcmp(event->name, ipc_server_filename) == 0)
+                    created = true;
+                i += sizeof(struct inotify_event) + event->len;
             }
         }
+        return created;
+    }
 
-        if(connected_to_ipc && event_callback) {
-            Error err = read_ipc_func();
-            if(err != Error::OK)
-                return err;
+    VideoPlayer::Error VideoPlayer::try_connect() {
+        // Without inotify we don't know when mpv has created the socket, so it's always tried
+        if(!ipc_server_created && (inotify_fd == -1 || ipc_server_created_event() || access(ipc_server_path, F_OK) == 0))
+            ipc_server_created = true;
+
+        if(ipc_server_created) {
+            // The socket file is created before mpv starts listening on it, so this can fail a few times
+            if(connect(ipc_socket, (struct sockaddr*)&ipc_addr, sizeof(ipc_addr)) == 0) {
+                connected_to_ipc = true;
+                if(inotify_fd != -1) {
+                    close(inotify_fd);
+                    inotify_fd = -1;
+                }
+
+                Error err = observe_properties();
+                if(err != Error::OK)
+                    return err;
+
+                if(!queued_commands.empty()) {
+                    err = send_command(queued_commands.c_str(), queued_commands.size());
+                    queued_commands.clear();
+                    if(err != Error::OK)
+                        return err;
+                }
+                return Error::OK;
+            }
         }
 
+        if(connect_timer.getElapsedTime().asMilliseconds() >= CONNECT_TIMEOUT_MS) {
+            fprintf(stderr, "Failed to connect to mpv ipc after %d seconds, last error: %s\n", CONNECT_TIMEOUT_MS / 1000, strerror(errno));
+            return Error::FAIL_TO_CONNECT_TIMEOUT;
+        }
         return Error::OK;
     }
 
     VideoPlayer::Error VideoPlayer::read_ipc_func() {
         assert(connected_to_ipc);
-        Json::Value json_root;
-        Json::CharReaderBuilder json_builder;
-        std::unique_ptr<Json::CharReader> json_reader(json_builder.newCharReader());
-        std::string json_errors;
+        // Read everything that is available, so events don't pile up in the socket when mpv sends a lot of them
+        while(true) {
+            if(read_buffer.size() - read_buffer_end < READ_CHUNK_SIZE) {
+                // Move the partial message to the beginning of the buffer and only grow the buffer if the message doesn't fit
+                if(read_buffer_begin > 0) {
+                    memmove(read_buffer.data(), read_buffer.data() + read_buffer_begin, read_buffer_end - read_buffer_begin);
+                    read_buffer_end -= read_buffer_begin;
+                    read_buffer_begin = 0;
+                }
+                if(read_buffer.size() - read_buffer_end < READ_CHUNK_SIZE)
+                    read_buffer.resize(read_buffer_end + READ_CHUNK_SIZE);
+            }
 
-        char buffer[2048];
-        ssize_t bytes_read = read(ipc_socket, buffer, sizeof(buffer));
-        if(bytes_read == -1) {
-            int err = errno;
-            if(err != EAGAIN) {
+            ssize_t bytes_read = read(ipc_socket, read_buffer.data() + read_buffer_end, read_buffer.size() - read_buffer_end);
+            if(bytes_read == -1) {
+                int err = errno;
+                if(err == EINTR)
+                    continue;
+                if(err == EAGAIN || err == EWOULDBLOCK)
+                    break;
                 fprintf(stderr, "Failed to read from ipc socket, error: %s\n", strerror(err));
                 return Error::FAIL_TO_READ;
+            } else if(bytes_read == 0) {
+                fprintf(stderr, "mpv closed the ipc socket\n");
+                disconnect();
+                return Error::DISCONNECTED;
             }
-        } else if(bytes_read > 0) {
-            int start = 0;
-            for(int i = 0; i < bytes_read; ++i) {
-                if(buffer[i] != '\n')
-                    continue;
 
-                if(json_reader->parse(buffer + start, buffer + i, &json_root, &json_errors)) {
-                    const Json::Value &event = json_root["event"];
-                    const Json::Value &request_id_json = json_root["request_id"];
-                    if(event.isString()) {
-                        if(event_callback)
-                            event_callback(event.asCString());
-                    }
-
-                    if(expected_request_id != 0 && request_id_json.isNumeric() && request_id_json.asUInt() == expected_request_id) {
-                        if(json_root["error"].isNull())
-                            response_data_status = ResponseDataStatus::ERROR;
-                        else
-                            response_data_status = ResponseDataStatus::OK;
-                        request_response_data = json_root["data"];
-                    }
-                } else {
-                    fprintf(stderr, "Failed to parse json for ipc: |%.*s|, reason: %s\n", (int)bytes_read, buffer, json_errors.c_str());
-                }
+            size_t search_start = read_buffer_end;
+            read_buffer_end += bytes_read;
+            while(true) {
+                char *message_end = (char*)memchr(read_buffer.data() + search_start, '\n', read_buffer_end - search_start);
+                if(!message_end)
+                    break;
+
+                handle_ipc_message(read_buffer.data() + read_buffer_begin, message_end);
+                read_buffer_begin = (message_end + 1) - read_buffer.data();
+                search_start = read_buffer_begin;
+            }
 
-                start = i + 1;
+            if(read_buffer_begin == read_buffer_end) {
+                read_buffer_begin = 0;
+                read_buffer_end = 0;
             }
         }
         return Error::OK;
     }
 
+    void VideoPlayer::disconnect() {
+        if(ipc_socket != -1) {
+            close(ipc_socket);
+            ipc_socket = -1;
+        }
+        connected_to_ipc = false;
+        queued_commands.clear();
+        read_buffer_begin = 0;
+        read_buffer_end = 0;
+
+        std::vector<RequestCallback> failed_callbacks;
+        for(auto &it : pending_requests) {
+            failed_callbacks.push_back(std::move(it.second.callback));
+        }
+        pending_requests.clear();
+
+        const Json::Value null_value(Json::nullValue);
+        for(auto &callback : failed_callbacks) {
+            callback(Error::DISCONNECTED, null_value);
+        }
+    }
+
+    void VideoPlayer::handle_ipc_message(const char *message_begin, const char *message_end) {
+        std::string json_errors;
+        if(!json_reader->parse(message_begin, message_end, &ipc_message_json, &json_errors)) {
+            fprintf(stderr, "Failed to parse json for ipc: |%.*s|, reason: %s\n", (int)(message_end - message_begin), message_begin, json_errors.c_str());
+            return;
+        }
+
+        const Json::Value &event = ipc_message_json["event"];
+        if(event.isString()) {
+            if(strcmp(event.asCString(), "property-change") == 0)
+                handle_property_change(ipc_message_json);
+            else if(event_callback)
+                event_callback(event.asCString());
+        } else {
+            handle_request_response(ipc_message_json);
+        }
+    }
+
+    void VideoPlayer::handle_request_response(const Json::Value &json_root) {
+        const Json::Value &request_id_json = json_root["request_id"];
+        if(!request_id_json.isNumeric())
+            return;
+
+        auto it = pending_requests.find(request_id_json.asUInt());
+        if(it == pending_requests.end())
+            return;
+
+        // The callback may make new requests, so it's removed from the pending requests before it's called
+        PendingRequest request = std::move(it->second);
+        pending_requests.erase(it);
+
+        const Json::Value &error_json = json_root["error"];
+        const Json::Value &data = json_root["data"];
+        if(!error_json.isString() || strcmp(error_json.asCString(), "success") != 0)
+            request.callback(Error::READ_RESPONSE_ERROR, data);
+        else if(data.type() != request.result_type && !(request.result_type == Json::realValue && data.isNumeric()))
+            request.callback(Error::READ_INCORRECT_TYPE, data);
+        else
+            request.callback(Error::OK, data);
+    }
+
+    void VideoPlayer::remove_timed_out_requests() {
+        std::vector<RequestCallback> timed_out_callbacks;
+        for(auto it = pending_requests.begin(); it != pending_requests.end();) {
+            if(it->second.timer.getElapsedTime().asMilliseconds() >= READ_TIMEOUT_MS) {
+                timed_out_callbacks.push_back(std::move(it->second.callback));
+                it = pending_requests.erase(it);
+            } else {
+                ++it;
+            }
+        }
+
+        const Json::Value null_value(Json::nullValue);
+        for(auto &callback : timed_out_callbacks) {
+            callback(Error::READ_TIMEOUT, null_value);
+        }
+    }
+
+    VideoPlayer::Error VideoPlayer::observe_properties() {
+        const char *properties[] = { "percent-pos", "time-remaining", "seekable", "pause", "eof-reached", "path" };
+        std::string cmd;
+        for(size_t i = 0; i < sizeof(properties) / sizeof(properties[0]); ++i) {
+            // The id is not needed since the property change events include the name of the property
+            cmd += "{ \"command\": [\"observe_property\", " + std::to_string(1 + i) + ", \"" + properties[i] + "\"] }\n";
+        }
+        return send_command(cmd.c_str(), cmd.size());
+    }
+
+    void VideoPlayer::handle_property_change(const Json::Value &json_root) {
+        const Json::Value &name_json = json_root["name"];
+        if(!name_json.isString())
+            return;
+
+        // Data is missing if the property is not available, for example when there is no video loaded
+        const char *name = name_json.asCString();
+        const Json::Value &data = json_root["data"];
+        if(strcmp(name, "percent-pos") == 0) {
+            playback_state.progress = data.isNumeric() ? data.asDouble() * 0.01 : 0.0;
+        } else if(strcmp(name, "time-remaining") == 0) {
+            playback_state.time_remaining = data.isNumeric() ? data.asDouble() : 0.0;
+        } else if(strcmp(name, "seekable") == 0) {
+            playback_state.seekable = data.isBool() && data.asBool();
+        } else if(strcmp(name, "pause") == 0) {
+            playback_state.paused = data.isBool() && data.asBool();
+        } else if(strcmp(name, "eof-reached") == 0) {
+            const bool eof_reached = data.isBool() && data.asBool();
+            const bool reached_now = eof_reached && !playback_state.eof_reached;
+            playback_state.eof_reached = eof_reached;
+            if(reached_now && event_callback)
+                event_callback("eof-reached");
+        } else if(strcmp(name, "path") == 0) {
+            std::string path = data.isString() ? data.asString() : "";
+            if(path != playback_state.path) {
+                playback_state.path = std::move(path);
+                if(event_callback)
+                    event_callback("path-changed");
+            }
+        }
+    }
+
     VideoPlayer::Error VideoPlayer::toggle_pause() {
         const char cmd[] = "cycle pause\n";
         return send_command(cmd, sizeof(cmd) - 1);
     }
 
-    VideoPlayer::Error VideoPlayer::get_progress(double *result) {
-        Json::Value percent_pos_json;
-        Error err = get_property("percent-pos", &percent_pos_json, Json::realValue);
-        if(err != Error::OK)
-            return err;
-
-        *result = percent_pos_json.asDouble() * 0.01;
-        return err;
+    VideoPlayer::Error VideoPlayer::get_progress(std::function<void(Error error, double progress)> callback) {
+        return get_property("percent-pos", Json::realValue, [callback](Error error, const Json::Value &data) {
+            callback(error, error == Error::OK ? data.asDouble() * 0.01 : 0.0);
+        });
     }
 
-    VideoPlayer::Error VideoPlayer::get_time_remaining(double *result) {
-        Json::Value time_remaining_json;
-        Error err = get_property("time-remaining", &time_remaining_json, Json::realValue);
-        if(err != Error::OK)
-            return err;
-
-        *result = time_remaining_json.asDouble();
-        return err;
+    VideoPlayer::Error VideoPlayer::get_time_remaining(std::function<void(Error error, double time_remaining)> callback) {
+        return get_property("time-remaining", Json::realValue, [callback](Error error, const Json::Value &data) {
+            callback(error, error == Error::OK ? data.asDouble() : 0.0);
+        });
     }
 
     VideoPlayer::Error VideoPlayer::set_property(const std::string &property_name, const Json::Value &value) {
@@ -275,7 +508,7 @@ namespace QuickMedia {
         return send_command(cmd_str.c_str(), cmd_str.size());
     }
 
-    VideoPlayer::Error VideoPlayer::get_property(const std::string &property_name, Json::Value *result, Json::ValueType result_type) {
+    VideoPlayer::Error VideoPlayer::get_property(const std::string &property_name, Json::ValueType result_type, RequestCallback callback) {
         unsigned int cmd_request_id = request_id;
         ++request_id;
         // Overflow check. 0 is defined as no request, 1 is the first valid one
@@ -298,35 +531,11 @@ namespace QuickMedia {
         if(err != Error::OK)
             return err;
 
-        sf::Clock read_timer;
-        expected_request_id = cmd_request_id;
-        do {
-            err = read_ipc_func();
-            if(err != Error::OK)
-                goto cleanup;
-
-            if(response_data_status != ResponseDataStatus::NONE)
-                break;
-        } while(read_timer.getElapsedTime().asMilliseconds() < READ_TIMEOUT_MS);
-
-        if(response_data_status == ResponseDataStatus::OK) {
-            if(request_response_data.type() == result_type)
-                *result = request_response_data;
-            else
-                err = Error::READ_INCORRECT_TYPE;
-        } else if(response_data_status == ResponseDataStatus::ERROR) {
-            err = Error::READ_RESPONSE_ERROR;
-            goto cleanup;
-        } else {
-            err = Error::READ_TIMEOUT;
-            goto cleanup;
-        }
-
-        cleanup:
-        expected_request_id = 0;
-        response_data_status = ResponseDataStatus::NONE;
-        request_response_data = Json::Value(Json::nullValue);
-        return err;
+        PendingRequest &request = pending_requests[cmd_request_id];
+        request.result_type = result_type;
+        request.callback = std::move(callback);
+        request.timer.restart();
+        return Error::OK;
     }
 
     VideoPlayer::Error VideoPlayer::set_paused(bool paused) {
@@ -334,24 +543,23 @@ namespace QuickMedia {
     }
 
     VideoPlayer::Error VideoPlayer::set_progress(double progress) {
-        std::string cmd = "{ \"command\": [\"set_property\", \"percent-pos\", ";
-        cmd += std::to_string(progress * 100.0) + "] }";
-        return send_command(cmd.c_str(), cmd.size());
+        return set_property("percent-pos", progress * 100.0);
     }
 
-    VideoPlayer::Error VideoPlayer::is_seekable(bool *result) {
-        Json::Value seekable_json;
-        Error err = get_property("seekable", &seekable_json, Json::booleanValue);
-        if(err != Error::OK)
-            return err;
-
-        *result = seekable_json.asBool();
-        return err;
+    VideoPlayer::Error VideoPlayer::is_seekable(std::function<void(Error error, bool seekable)> callback) {
+        return get_property("seekable", Json::booleanValue, [callback](Error error, const Json::Value &data) {
+            callback(error, error == Error::OK ? data.asBool() : false);
+        });
     }
 
     VideoPlayer::Error VideoPlayer::send_command(const char *cmd, size_t size) {
-        if(!connected_to_ipc)
-            return Error::FAIL_NOT_CONNECTED;
+        if(!connected_to_ipc) {
+            if(ipc_socket == -1)
+                return Error::FAIL_NOT_CONNECTED;
+            // Sent once mpv has been connected to
+            queued_commands.append(cmd, size);
+            return Error::OK;
+        }
 
         if(send(ipc_socket, cmd, size, 0) == -1) {
             fprintf(stderr, "Failed to send to ipc socket, error: %s, command: %.*s\n", strerror(errno), (int)size, cmd);
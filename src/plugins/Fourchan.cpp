@@ -4,6 +4,7 @@
 #include "../../include/DataView.hpp"
 #include <tidy.h>
 #include <tidybuffio.h>
+#include <unordered_set>
 
 // API documentation: https://github.com/4chan/4chan-API
 
@@ -170,6 +171,10 @@ namespace QuickMedia {
             return PluginResult::ERR;
         }
 
+        BoardCatalog &board_catalog = board_catalogs[url];
+        board_catalog.thread_order.clear();
+        board_catalog.search_index.begin_update();
+
         if(json_root.isArray()) {
             for(const Json::Value &page_data : json_root) {
                 if(!page_data.isObject())
@@ -183,6 +188,24 @@ namespace QuickMedia {
                     if(!thread.isObject())
                         continue;
 
+                    const Json::Value &thread_num = thread["no"];
+                    if(!thread_num.isNumeric())
+                        continue;
+
+                    std::string thread_id = std::to_string(thread_num.asInt64());
+                    // Threads without last_modified are always parsed again
+                    const Json::Value &last_modified_json = thread["last_modified"];
+                    int64_t last_modified = last_modified_json.isNumeric() ? last_modified_json.asInt64() : -1;
+
+                    auto catalog_thread_it = board_catalog.threads.find(thread_id);
+                    if(last_modified != -1 && catalog_thread_it != board_catalog.threads.end() && catalog_thread_it->second.last_modified == last_modified
+                        && board_catalog.search_index.keep_document(thread_id, last_modified))
+                    {
+                        board_catalog.thread_order.push_back(thread_id);
+                        result_items.push_back(std::make_unique<BodyItem>(*catalog_thread_it->second.body_item));
+                        continue;
+                    }
+
                     const Json::Value &sub = thread["sub"];
                     const char *sub_begin = "";
                     const char *sub_end = sub_begin;
@@ -193,10 +216,6 @@ namespace QuickMedia {
                     const char *comment_end = comment_begin;
                     com.getString(&comment_begin, &comment_end);
 
-                    const Json::Value &thread_num = thread["no"];
-                    if(!thread_num.isNumeric())
-                        continue;
-
                     std::string comment_text;
                     extract_comment_pieces(sub_begin, sub_end - sub_begin,
                         [&comment_text](const CommentPiece &cp) {
@@ -249,6 +268,8 @@ namespace QuickMedia {
                     if(!comment_text.empty() && comment_text.back() == '\n')
                         comment_text.back() = ' ';
                     html_unescape_sequences(comment_text);
+                    // The whole comment is searchable, not only the part that is visible
+                    board_catalog.search_index.update_document(thread_id, comment_text, last_modified);
                     // TODO: Do the same when wrapping is implemented
                     int num_lines = 0;
                     for(size_t i = 0; i < comment_text.size(); ++i) {
@@ -261,7 +282,7 @@ namespace QuickMedia {
                         }
                     }
                     auto body_item = std::make_unique<BodyItem>(std::move(comment_text));
-                    body_item->url = std::to_string(thread_num.asInt64());
+                    body_item->url = thread_id;
 
                     const Json::Value &ext = thread["ext"];
                     const Json::Value &tim = thread["tim"];
@@ -275,12 +296,47 @@ namespace QuickMedia {
                         // thumbnails always has .jpg extension even if they are gifs or webm.
                         body_item->thumbnail_url = fourchan_image_url + url + "/" + std::to_string(tim.asInt64()) + "s.jpg";
                     }
-                    
+
+                    board_catalog.thread_order.push_back(thread_id);
+                    board_catalog.threads[thread_id] = { last_modified, std::make_unique<BodyItem>(*body_item) };
                     result_items.emplace_back(std::move(body_item));
                 }
             }
         }
 
+        // Threads that have fallen off the catalog
+        board_catalog.search_index.end_update();
+        std::unordered_set<std::string> catalog_thread_ids(board_catalog.thread_order.begin(), board_catalog.thread_order.end());
+        for(auto it = board_catalog.threads.begin(); it != board_catalog.threads.end();) {
+            if(catalog_thread_ids.find(it->first) == catalog_thread_ids.end())
+                it = board_catalog.threads.erase(it);
+            else
+                ++it;
+        }
+
+        return PluginResult::OK;
+    }
+
+    PluginResult Fourchan::search_threads(const std::string &url, const std::string &text, BodyItems &result_items) {
+        auto board_catalog_it = board_catalogs.find(url);
+        if(board_catalog_it == board_catalogs.end())
+            return PluginResult::ERR;
+
+        BoardCatalog &board_catalog = board_catalog_it->second;
+        if(strip(text).empty()) {
+            for(const std::string &thread_id : board_catalog.thread_order) {
+                auto thread_it = board_catalog.threads.find(thread_id);
+                if(thread_it != board_catalog.threads.end())
+                    result_items.push_back(std::make_unique<BodyItem>(*thread_it->second.body_item));
+            }
+            return PluginResult::OK;
+        }
+
+        for(const TextSearchMatch &match : board_catalog.search_index.search(text)) {
+            auto thread_it = board_catalog.threads.find(match.document_id);
+            if(thread_it != board_catalog.threads.end())
+                result_items.push_back(std::make_unique<BodyItem>(*thread_it->second.body_item));
+        }
         return PluginResult::OK;
     }
 
@@ -1,32 +1,45 @@
 #include "../../plugins/Manganelo.hpp"
-#include <quickmedia/HtmlSearch.h>
+#include "../../include/HtmlMultiSearch.hpp"
+#include "../../include/Storage.hpp"
+#include "../../include/HostStats.hpp"
 #include <json/reader.h>
+#include <json/writer.h>
+#include <algorithm>
+#include <stdio.h>
 
 namespace QuickMedia {
+    // The image urls of this many chapters are cached
+    static const size_t MAX_CACHED_CHAPTERS = 32;
+    // Cached image urls are downloaded again after this long, in case the chapter has been changed or moved to another server
+    static const time_t IMAGE_URLS_TTL_SEC = 60 * 60 * 24;
+    // Image servers that have the same images at the same paths
+    static const std::vector<std::vector<std::string>> IMAGE_MIRROR_HOSTS = {
+        { "s3.mkklcdnv3.com", "bu.mkklcdnbuv1.com" }
+    };
+
+    Manganelo::Manganelo() : Plugin("manganelo") {
+        load_image_urls_cache();
+    }
+
     SearchResult Manganelo::search(const std::string &url, BodyItems &result_items) {
         std::string website_data;
         if(download_to_string(url, website_data, {}, use_tor) != DownloadResult::OK)
             return SearchResult::NET_ERR;
 
-        QuickMediaHtmlSearch html_search;
-        int result = quickmedia_html_search_init(&html_search, website_data.c_str());
-        if(result != 0)
-            goto cleanup;
-
-        result = quickmedia_html_find_nodes_xpath(&html_search, "//ul[class='row-content-chapter']//a",
-            [](QuickMediaHtmlNode *node, void *userdata) {
-                auto *item_data = (BodyItems*)userdata;
-                const char *href = quickmedia_html_node_get_attribute_value(node, "href");
-                const char *text = quickmedia_html_node_get_text(node);
-                if(href && text) {
-                    auto item = std::make_unique<BodyItem>(strip(text));
+        HtmlMultiSearch html_search;
+        html_search.add_query("//ul[class='row-content-chapter']//a",
+            [&result_items](const HtmlNode &node) {
+                const char *href = node.get_attribute_value("href");
+                std::string title = strip(node.get_text());
+                if(href && !title.empty()) {
+                    html_unescape_sequences(title);
+                    auto item = std::make_unique<BodyItem>(std::move(title));
                     item->url = href;
-                    item_data->push_back(std::move(item));
+                    result_items.push_back(std::move(item));
                 }
-            }, &result_items);
+            });
 
-        cleanup:
-        quickmedia_html_search_deinit(&html_search);
+        int result = html_search.run(website_data.c_str());
         return result == 0 ? SearchResult::OK : SearchResult::ERR;
     }
 
@@ -53,7 +66,7 @@ namespace QuickMedia {
     SuggestionResult Manganelo::update_search_suggestions(const std::string &text, BodyItems &result_items) {
         std::string url = "https://manganelo.com/getstorysearchjson";
         std::string search_term = "searchword=";
-        search_term += url_param_encode(text);
+        url_param_encode_append(text.data(), text.size(), search_term);
         CommandArg data_arg = { "--data", std::move(search_term) };
 
         std::string server_response;
@@ -80,6 +93,7 @@ namespace QuickMedia {
                     if(name.isString() && name.asCString()[0] != '\0' && nameunsigned.isString() && nameunsigned.asCString()[0] != '\0') {
                         std::string name_str = name.asString();
                         while(remove_html_span(name_str)) {}
+                        html_unescape_sequences(name_str);
                         auto item = std::make_unique<BodyItem>(strip(name_str));
                         item->url = "https://manganelo.com/manga/" + url_param_encode(nameunsigned.asString());
                         Json::Value image = child.get("image", "");
@@ -93,68 +107,172 @@ namespace QuickMedia {
         return SuggestionResult::OK;
     }
 
-    ImageResult Manganelo::get_number_of_images(const std::string &url, int &num_images) {
-        std::lock_guard<std::mutex> lock(image_urls_mutex);
+    ImageResult Manganelo::get_number_of_images(const std::string &url, int &num_images, DownloadProgressCallback progress_callback) {
         num_images = 0;
-        ImageResult image_result = get_image_urls_for_chapter(url);
+        ImageUrls image_urls;
+        ImageResult image_result = get_image_urls_for_chapter(url, image_urls, std::move(progress_callback));
         if(image_result != ImageResult::OK)
             return image_result;
 
-        num_images = last_chapter_image_urls.size();
+        num_images = image_urls->size();
         return ImageResult::OK;
     }
 
-    ImageResult Manganelo::get_image_urls_for_chapter(const std::string &url) {
-        if(url == last_chapter_url)
-            return ImageResult::OK;
-
-        last_chapter_image_urls.clear();
+    ImageResult Manganelo::get_image_urls_for_chapter(const std::string &url, ImageUrls &image_urls, DownloadProgressCallback progress_callback) {
+        {
+            std::shared_lock<std::shared_mutex> lock(image_urls_mutex);
+            auto it = chapter_image_urls.find(url);
+            if(it != chapter_image_urls.end() && time(NULL) - it->second.download_time < IMAGE_URLS_TTL_SEC) {
+                it->second.last_used = ++image_urls_use_counter;
+                image_urls = it->second.image_urls;
+                return ImageResult::OK;
+            }
+        }
 
+        // Downloaded without the lock, so other chapters can be used while this one is downloading
         std::string website_data;
-        if(download_to_string(url, website_data, {}, use_tor) != DownloadResult::OK)
+        if(download_to_string(url, website_data, {}, use_tor, std::move(progress_callback)) != DownloadResult::OK)
             return ImageResult::NET_ERR;
 
-        QuickMediaHtmlSearch html_search;
-        int result = quickmedia_html_search_init(&html_search, website_data.c_str());
-        if(result != 0)
-            goto cleanup;
-
-        result = quickmedia_html_find_nodes_xpath(&html_search, "//div[class='container-chapter-reader']/img",
-            [](QuickMediaHtmlNode *node, void *userdata) {
-                auto *urls = (std::vector<std::string>*)userdata;
-                const char *src = quickmedia_html_node_get_attribute_value(node, "src");
-                if(src) {
-                    // TODO: If image loads too slow, try switching mirror
-                    std::string image_url = src;
-                    //string_replace_all(image_url, "s3.mkklcdnv3.com", "bu.mkklcdnbuv1.com");
-                    urls->emplace_back(std::move(image_url));
-                }
-            }, &last_chapter_image_urls);
+        std::vector<std::string> new_image_urls;
+        HtmlMultiSearch html_search;
+        html_search.add_query("//div[class='container-chapter-reader']/img",
+            [&new_image_urls](const HtmlNode &node) {
+                const char *src = node.get_attribute_value("src");
+                if(src)
+                    new_image_urls.emplace_back(src);
+            });
 
-        cleanup:
-        quickmedia_html_search_deinit(&html_search);
-        if(result == 0)
-            last_chapter_url = url;
-        if(last_chapter_image_urls.empty())
+        int result = html_search.run(website_data.c_str());
+        if(new_image_urls.empty() || result != 0)
             return ImageResult::ERR;
-        return result == 0 ? ImageResult::OK : ImageResult::ERR;
-    }
 
-    ImageResult Manganelo::for_each_page_in_chapter(const std::string &chapter_url, PageCallback callback) {
-        std::vector<std::string> image_urls;
+        image_urls = std::make_shared<const std::vector<std::string>>(std::move(new_image_urls));
         {
-            std::lock_guard<std::mutex> lock(image_urls_mutex);
-            ImageResult image_result = get_image_urls_for_chapter(chapter_url);
-            if(image_result != ImageResult::OK)
-                return image_result;
+            std::unique_lock<std::shared_mutex> lock(image_urls_mutex);
+            if(chapter_image_urls.size() >= MAX_CACHED_CHAPTERS && chapter_image_urls.find(url) == chapter_image_urls.end()) {
+                auto least_recently_used = std::min_element(chapter_image_urls.begin(), chapter_image_urls.end(), [](const auto &chapter1, const auto &chapter2) {
+                    return chapter1.second.last_used < chapter2.second.last_used;
+                });
+                chapter_image_urls.erase(least_recently_used);
+            }
 
-            image_urls = last_chapter_image_urls;
+            ChapterImageUrls &chapter = chapter_image_urls[url];
+            chapter.image_urls = image_urls;
+            chapter.download_time = time(NULL);
+            chapter.last_used = ++image_urls_use_counter;
         }
+        save_image_urls_cache();
+        return ImageResult::OK;
+    }
 
-        for(const std::string &url : image_urls) {
+    ImageResult Manganelo::for_each_page_in_chapter(const std::string &chapter_url, PageCallback callback, DownloadProgressCallback progress_callback) {
+        // The urls are shared with the cache instead of copied. They are kept alive even if the chapter is removed from the cache
+        ImageUrls image_urls;
+        ImageResult image_result = get_image_urls_for_chapter(chapter_url, image_urls, std::move(progress_callback));
+        if(image_result != ImageResult::OK)
+            return image_result;
+
+        for(const std::string &url : *image_urls) {
             if(!callback(url))
                 break;
         }
         return ImageResult::OK;
     }
+
+    std::vector<std::string> Manganelo::get_page_mirror_urls(const std::string &image_url) const {
+        std::vector<std::string> urls = { image_url };
+        const std::string host = get_url_host(image_url);
+        for(const std::vector<std::string> &mirror_hosts : IMAGE_MIRROR_HOSTS) {
+            if(std::find(mirror_hosts.begin(), mirror_hosts.end(), host) == mirror_hosts.end())
+                continue;
+
+            const size_t host_index = image_url.find(host);
+            for(const std::string &mirror_host : mirror_hosts) {
+                if(mirror_host != host)
+                    urls.push_back(image_url.substr(0, host_index) + mirror_host + image_url.substr(host_index + host.size()));
+            }
+        }
+        return urls;
+    }
+
+    static Path get_image_urls_cache_path() {
+        return get_cache_dir().join("manganelo_image_urls.json");
+    }
+
+    // Cache format: { "<chapter url>": { "time": download time, "images": [ "<image url>" ] } }
+    void Manganelo::load_image_urls_cache() {
+        std::string file_content;
+        if(file_get_content(get_image_urls_cache_path(), file_content) != 0)
+            return;
+
+        Json::Value json_root;
+        Json::CharReaderBuilder json_builder;
+        std::unique_ptr<Json::CharReader> json_reader(json_builder.newCharReader());
+        std::string json_errors;
+        if(!json_reader->parse(file_content.data(), file_content.data() + file_content.size(), &json_root, &json_errors) || !json_root.isObject()) {
+            fprintf(stderr, "Failed to read the manganelo image url cache, error: %s\n", json_errors.c_str());
+            return;
+        }
+
+        std::vector<std::pair<time_t, std::string>> chapters_by_time;
+        const time_t now = time(NULL);
+        std::unique_lock<std::shared_mutex> lock(image_urls_mutex);
+        for(auto it = json_root.begin(); it != json_root.end(); ++it) {
+            const Json::Value &json_time = (*it)["time"];
+            const Json::Value &json_images = (*it)["images"];
+            if(!json_time.isIntegral() || !json_images.isArray() || json_images.empty() || now - (time_t)json_time.asInt64() >= IMAGE_URLS_TTL_SEC)
+                continue;
+
+            auto image_urls = std::make_shared<std::vector<std::string>>();
+            for(const Json::Value &json_image : json_images) {
+                if(json_image.isString())
+                    image_urls->push_back(json_image.asString());
+            }
+
+            ChapterImageUrls &chapter = chapter_image_urls[it.name()];
+            chapter.image_urls = std::move(image_urls);
+            chapter.download_time = json_time.asInt64();
+            chapters_by_time.push_back(std::make_pair(chapter.download_time, it.name()));
+        }
+
+        // The chapters that were downloaded last are the ones that were used last
+        std::sort(chapters_by_time.begin(), chapters_by_time.end());
+        for(auto &it : chapters_by_time) {
+            chapter_image_urls[it.second].last_used = ++image_urls_use_counter;
+        }
+        while(chapter_image_urls.size() > MAX_CACHED_CHAPTERS) {
+            chapter_image_urls.erase(chapters_by_time.front().second);
+            chapters_by_time.erase(chapters_by_time.begin());
+        }
+    }
+
+    void Manganelo::save_image_urls_cache() {
+        std::lock_guard<std::mutex> save_lock(image_urls_save_mutex);
+        Json::Value json_root(Json::objectValue);
+        {
+            std::shared_lock<std::shared_mutex> lock(image_urls_mutex);
+            for(auto &it : chapter_image_urls) {
+                Json::Value json_images(Json::arrayValue);
+                for(const std::string &image_url : *it.second.image_urls) {
+                    json_images.append(image_url);
+                }
+
+                Json::Value &json_chapter = json_root[it.first];
+                json_chapter["time"] = (Json::Int64)it.second.download_time;
+                json_chapter["images"] = std::move(json_images);
+            }
+        }
+
+        Json::StreamWriterBuilder json_builder;
+        json_builder["indentation"] = "";
+        Path cache_path = get_image_urls_cache_path();
+        Path tmp_cache_path(cache_path.data + ".tmp");
+        if(create_directory_recursive(get_cache_dir()) != 0
+            || file_overwrite(tmp_cache_path, Json::writeString(json_builder, json_root)) != 0
+            || rename(tmp_cache_path.data.c_str(), cache_path.data.c_str()) != 0)
+        {
+            fprintf(stderr, "Failed to save the manganelo image url cache to %s\n", cache_path.data.c_str());
+        }
+    }
 }
\ No newline at end of file
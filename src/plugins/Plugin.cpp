@@ -1,7 +1,4 @@
 #include "../../plugins/Plugin.hpp"
-#include <sstream>
-#include <iomanip>
-#include <array>
 
 namespace QuickMedia {
     SearchResult Plugin::search(const std::string &text, BodyItems &result_items) {
@@ -20,41 +17,4 @@ namespace QuickMedia {
         (void)url;
         return {};
     }
-
-    struct HtmlEscapeSequence {
-        std::string escape_sequence;
-        std::string unescaped_str;
-    };
-
-    void html_unescape_sequences(std::string &str) {
-        const std::array<HtmlEscapeSequence, 6> escape_sequences = {
-            HtmlEscapeSequence { "&quot;", "\"" },
-            HtmlEscapeSequence { "&#039;", "'" },
-            HtmlEscapeSequence { "&#39;", "'" },
-            HtmlEscapeSequence { "&lt;", "<" },
-            HtmlEscapeSequence { "&gt;", ">" },
-            HtmlEscapeSequence { "&amp;", "&" } // This should be last, to not accidentally replace a new sequence caused by replacing this
-        };
-
-        for(const HtmlEscapeSequence &escape_sequence : escape_sequences) {
-            string_replace_all(str, escape_sequence.escape_sequence, escape_sequence.unescaped_str);
-        }
-    }
-
-    std::string Plugin::url_param_encode(const std::string &param) const {
-        std::ostringstream result;
-        result.fill('0');
-        result << std::hex;
-
-        for(char c : param) {
-            if(isalnum(c) || c == '-' || c == '_' || c == '.' || c == '~') {
-                result << c;
-            } else {
-                result << std::uppercase;
-                result << "%" << std::setw(2) << (int)(unsigned char)(c);
-            }
-        }
-
-        return result.str();
-    }
 }
\ No newline at end of file
@@ -1,5 +1,5 @@
 #include "../../plugins/Pornhub.hpp"
-#include <quickmedia/HtmlSearch.h>
+#include "../../include/HtmlMultiSearch.hpp"
 #include <json/reader.h>
 #include <string.h>
 
@@ -25,61 +25,58 @@ namespace QuickMedia {
         }
     }
 
-    // TODO: Speed this up by using string.find instead of parsing html
-    SuggestionResult Pornhub::update_search_suggestions(const std::string &text, BodyItems &result_items) {
-        std::string url = "https://www.pornhub.com/video/search?search=";
-        url += url_param_encode(text);
-
-        std::string website_data;
-        if(download_to_string(url, website_data, {}, use_tor) != DownloadResult::OK)
-            return SuggestionResult::NET_ERR;
-
-        struct ItemData {
-            BodyItems *result_items;
-            size_t index;
-        };
-        ItemData item_data = { &result_items, 0 };
-
-        QuickMediaHtmlSearch html_search;
-        int result = quickmedia_html_search_init(&html_search, website_data.c_str());
-        if(result != 0)
-            goto cleanup;
-
-        result = quickmedia_html_find_nodes_xpath(&html_search, "//div[class='phimage']//a",
-            [](QuickMediaHtmlNode *node, void *userdata) {
-                auto *result_items = (BodyItems*)userdata;
-                const char *href = quickmedia_html_node_get_attribute_value(node, "href");
-                const char *title = quickmedia_html_node_get_attribute_value(node, "title");
-                if(href && title && begins_with(href, "/view_video.php?viewkey")) {
-                    auto item = std::make_unique<BodyItem>(strip(title));
+    // Each video is in a phimage div, with the link to the video and its thumbnail inside it
+    static int get_video_items(const std::string &website_data, const char *thumbnail_attribute_name, BodyItems &result_items) {
+        std::unique_ptr<BodyItem> item;
+        HtmlMultiSearch html_search;
+        int video_query = html_search.add_item_query("//div[class='phimage']",
+            [&item](const HtmlNode&) {
+                item = std::make_unique<BodyItem>("");
+            },
+            [&item, &result_items]() {
+                if(item && !item->url.empty())
+                    result_items.push_back(std::move(item));
+                item.reset();
+            });
+
+        html_search.add_item_child_query(video_query, "//a",
+            [&item](const HtmlNode &node) {
+                const char *href = node.get_attribute_value("href");
+                const char *title = node.get_attribute_value("title");
+                if(item && item->url.empty() && href && title && begins_with(href, "/view_video.php?viewkey")) {
+                    std::string title_str = strip(title);
+                    html_unescape_sequences(title_str);
+                    item->set_title(std::move(title_str));
                     item->url = std::string("https://www.pornhub.com") + href;
-                    result_items->push_back(std::move(item));
                 }
-            }, &result_items);
-        if(result != 0)
-            goto cleanup;
+            });
 
-        result = quickmedia_html_find_nodes_xpath(&html_search, "//div[class='phimage']//img",
-            [](QuickMediaHtmlNode *node, void *userdata) {
-                ItemData *item_data = (ItemData*)userdata;
-                if(item_data->index >= item_data->result_items->size())
-                    return;
+        html_search.add_item_child_query(video_query, "//img",
+            [&item, thumbnail_attribute_name](const HtmlNode &node) {
+                const char *thumbnail_url = node.get_attribute_value(thumbnail_attribute_name);
+                if(item && item->thumbnail_url.empty() && thumbnail_url && contains(thumbnail_url, "phncdn.com/videos"))
+                    item->thumbnail_url = thumbnail_url;
+            });
 
-                const char *data_src = quickmedia_html_node_get_attribute_value(node, "data-src");
-                if(data_src && contains(data_src, "phncdn.com/videos")) {
-                    (*item_data->result_items)[item_data->index]->thumbnail_url = data_src;
-                    ++item_data->index;
-                }
-            }, &item_data);
+        int result = html_search.run(website_data.c_str());
 
         // Attempt to skip promoted videos (that are not related to the search term)
         if(result_items.size() >= 4) {
             result_items.erase(result_items.begin(), result_items.begin() + 4);
         }
+        return result;
+    }
+
+    // TODO: Speed this up by using string.find instead of parsing html
+    SuggestionResult Pornhub::update_search_suggestions(const std::string &text, BodyItems &result_items) {
+        std::string url = "https://www.pornhub.com/video/search";
+        url_append_query_param(url, "search", text);
 
-        cleanup:
-        quickmedia_html_search_deinit(&html_search);
-        return result == 0 ? SuggestionResult::OK : SuggestionResult::ERR;
+        std::string website_data;
+        if(download_to_string(url, website_data, {}, use_tor) != DownloadResult::OK)
+            return SuggestionResult::NET_ERR;
+
+        return get_video_items(website_data, "data-src", result_items) == 0 ? SuggestionResult::OK : SuggestionResult::ERR;
     }
 
     BodyItems Pornhub::get_related_media(const std::string &url) {
@@ -89,51 +86,7 @@ namespace QuickMedia {
         if(download_to_string(url, website_data, {}, use_tor) != DownloadResult::OK)
             return result_items;
 
-        struct ItemData {
-            BodyItems *result_items;
-            size_t index;
-        };
-        ItemData item_data = { &result_items, 0 };
-
-        QuickMediaHtmlSearch html_search;
-        int result = quickmedia_html_search_init(&html_search, website_data.c_str());
-        if(result != 0)
-            goto cleanup;
-
-        result = quickmedia_html_find_nodes_xpath(&html_search, "//div[class='phimage']//a",
-            [](QuickMediaHtmlNode *node, void *userdata) {
-                auto *result_items = (BodyItems*)userdata;
-                const char *href = quickmedia_html_node_get_attribute_value(node, "href");
-                const char *title = quickmedia_html_node_get_attribute_value(node, "title");
-                if(href && title && begins_with(href, "/view_video.php?viewkey")) {
-                    auto item = std::make_unique<BodyItem>(strip(title));
-                    item->url = std::string("https://www.pornhub.com") + href;
-                    result_items->push_back(std::move(item));
-                }
-            }, &result_items);
-        if(result != 0)
-            goto cleanup;
-
-        result = quickmedia_html_find_nodes_xpath(&html_search, "//div[class='phimage']//img",
-            [](QuickMediaHtmlNode *node, void *userdata) {
-                ItemData *item_data = (ItemData*)userdata;
-                if(item_data->index >= item_data->result_items->size())
-                    return;
-
-                const char *src = quickmedia_html_node_get_attribute_value(node, "src");
-                if(src && contains(src, "phncdn.com/videos")) {
-                    (*item_data->result_items)[item_data->index]->thumbnail_url = src;
-                    ++item_data->index;
-                }
-            }, &item_data);
-
-        // Attempt to skip promoted videos (that are not related to the search term)
-        if(result_items.size() >= 4) {
-            result_items.erase(result_items.begin(), result_items.begin() + 4);
-        }
-
-        cleanup:
-        quickmedia_html_search_deinit(&html_search);
+        get_video_items(website_data, "src", result_items);
         return result_items;
     }
 }
\ No newline at end of file
@@ -0,0 +1,342 @@
+#include "../../plugins/YoutubeScan.hpp"
+#include "../../include/HtmlMultiSearch.hpp"
+#include "../../include/StringUtils.hpp"
+#include <string.h>
+
+namespace QuickMedia {
+    static bool begins_with(const char *str, const char *begin_with) {
+        return strncmp(str, begin_with, strlen(begin_with)) == 0;
+    }
+
+    static bool contains(const char *str, const char *substr) {
+        return strstr(str, substr);
+    }
+
+    static bool begins_with(const char *str, const char *end, const char *begin_with) {
+        const size_t len = strlen(begin_with);
+        return (size_t)(end - str) >= len && memcmp(str, begin_with, len) == 0;
+    }
+
+    static const char* find(const char *str, const char *end, const char *substr) {
+        return (const char*)memmem(str, end - str, substr, strlen(substr));
+    }
+
+    // Returns a pointer to the '>' that ends the tag that starts at @tag_begin, or nullptr if the tag is not closed
+    static const char* find_tag_end(const char *tag_begin, const char *end) {
+        char quote = '\0';
+        for(const char *c = tag_begin; c != end; ++c) {
+            if(quote != '\0') {
+                if(*c == quote)
+                    quote = '\0';
+            } else if(*c == '"' || *c == '\'') {
+                quote = *c;
+            } else if(*c == '>') {
+                return c;
+            }
+        }
+        return nullptr;
+    }
+
+    // Only double quoted attribute values are supported, that is all youtube uses
+    static bool tag_get_attribute_value(const char *tag_begin, const char *tag_end, const char *attribute_name, std::string &result) {
+        const size_t attribute_name_len = strlen(attribute_name);
+        const char *c = tag_begin;
+        while(true) {
+            c = (const char*)memmem(c, tag_end - c, attribute_name, attribute_name_len);
+            if(!c)
+                return false;
+
+            const char *value_begin = c + attribute_name_len;
+            const bool is_attribute_start = c[-1] == ' ' || c[-1] == '\n' || c[-1] == '\t';
+            c = value_begin;
+            if(!is_attribute_start || !begins_with(value_begin, tag_end, "=\""))
+                continue;
+
+            value_begin += 2;
+            const char *value_end = (const char*)memchr(value_begin, '"', tag_end - value_begin);
+            if(!value_end)
+                return false;
+
+            result.assign(value_begin, value_end - value_begin);
+            // Character references are decoded, like the html parser does with attribute values
+            if(memchr(value_begin, '&', value_end - value_begin))
+                html_unescape_sequences(result);
+            return true;
+        }
+    }
+
+    // The thumbnail of a search result comes before the title, so the last seen thumbnail belongs to the next title
+    bool youtube_scan_search_results(const std::string &website_data, BodyItems &result_items) {
+        const char *c = website_data.data();
+        const char *end = c + website_data.size();
+        std::string thumbnail_url;
+        std::string href;
+        std::string title;
+        std::string src;
+        bool found_titles = false;
+
+        while(true) {
+            c = find(c, end, "class=\"yt-");
+            if(!c)
+                break;
+            c += 10;
+
+            if(begins_with(c, end, "thumb-simple\"")) {
+                const char *img_begin = find(c, end, "<img");
+                if(!img_begin)
+                    break;
+                const char *img_end = find_tag_end(img_begin, end);
+                if(!img_end)
+                    break;
+
+                thumbnail_url.clear();
+                if(tag_get_attribute_value(img_begin, img_end, "src", src) && contains(src.c_str(), "i.ytimg.com/"))
+                    thumbnail_url = std::move(src);
+                else if(tag_get_attribute_value(img_begin, img_end, "data-thumb", src) && contains(src.c_str(), "i.ytimg.com/"))
+                    thumbnail_url = std::move(src);
+                c = img_end;
+            } else if(begins_with(c, end, "lockup-title")) {
+                const char *a_begin = find(c, end, "<a ");
+                if(!a_begin)
+                    break;
+                const char *a_end = find_tag_end(a_begin, end);
+                if(!a_end)
+                    break;
+
+                found_titles = true;
+                // Checking for watch?v helps skipping ads
+                if(tag_get_attribute_value(a_begin, a_end, "href", href) && tag_get_attribute_value(a_begin, a_end, "title", title) && begins_with(href.c_str(), "/watch?v=")) {
+                    std::string title_str = strip(title);
+                    html_unescape_sequences(title_str);
+                    auto item = std::make_unique<BodyItem>(std::move(title_str));
+                    item->url = "https://www.youtube.com" + href;
+                    item->thumbnail_url = std::move(thumbnail_url);
+                    result_items.push_back(std::move(item));
+                }
+                thumbnail_url.clear();
+                c = a_end;
+            }
+        }
+
+        return found_titles;
+    }
+
+    int youtube_parse_search_results(const std::string &website_data, BodyItems &result_items) {
+        std::unique_ptr<BodyItem> item;
+        HtmlMultiSearch html_search;
+        int lockup_query = html_search.add_item_query("//div[class='yt-lockup']",
+            [&item](const HtmlNode&) {
+                item = std::make_unique<BodyItem>("");
+            },
+            [&item, &result_items]() {
+                if(item && !item->url.empty())
+                    result_items.push_back(std::move(item));
+                item.reset();
+            });
+
+        html_search.add_item_child_query(lockup_query, "//h3[class='yt-lockup-title']/a",
+            [&item](const HtmlNode &node) {
+                const char *href = node.get_attribute_value("href");
+                const char *title = node.get_attribute_value("title");
+                // Checking for watch?v helps skipping ads
+                if(item && href && title && begins_with(href, "/watch?v=")) {
+                    std::string title_str = strip(title);
+                    html_unescape_sequences(title_str);
+                    item->set_title(std::move(title_str));
+                    item->url = std::string("https://www.youtube.com") + href;
+                }
+            });
+
+        html_search.add_item_child_query(lockup_query, "//span[class='yt-thumb-simple']//img",
+            [&item](const HtmlNode &node) {
+                if(!item)
+                    return;
+
+                const char *src = node.get_attribute_value("src");
+                const char *data_thumb = node.get_attribute_value("data-thumb");
+                if(src && contains(src, "i.ytimg.com/"))
+                    item->thumbnail_url = src;
+                else if(data_thumb && contains(data_thumb, "i.ytimg.com/"))
+                    item->thumbnail_url = data_thumb;
+            });
+
+        return html_search.run(website_data.c_str());
+    }
+
+    std::string youtube_remove_index_from_playlist_url(const std::string &url) {
+        std::string result = url;
+        size_t index = result.rfind("&index=");
+        if(index == std::string::npos)
+            return result;
+        return result.substr(0, index);
+    }
+
+    static const char* find_tag_begin_reverse(const char *begin, const char *c) {
+        while(c != begin) {
+            --c;
+            if(*c == '<')
+                return c;
+        }
+        return nullptr;
+    }
+
+    static bool is_whitespace(char c) {
+        return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+    }
+
+    // Returns true if the tag at @tag_begin is a @tag_name tag, for example "<li" or "</li"
+    static bool is_tag(const char *tag_begin, const char *end, const char *tag_name) {
+        const size_t len = strlen(tag_name);
+        if(!begins_with(tag_begin, end, tag_name) || (size_t)(end - tag_begin) <= len)
+            return false;
+        const char c = tag_begin[len];
+        return is_whitespace(c) || c == '>' || c == '/';
+    }
+
+    static bool class_list_contains(const std::string &class_list, const char *class_name) {
+        const size_t len = strlen(class_name);
+        for(size_t index = class_list.find(class_name); index != std::string::npos; index = class_list.find(class_name, index + 1)) {
+            const bool starts_class = index == 0 || is_whitespace(class_list[index - 1]);
+            const bool ends_class = index + len == class_list.size() || is_whitespace(class_list[index + len]);
+            if(starts_class && ends_class)
+                return true;
+        }
+        return false;
+    }
+
+    // Returns the start of the innermost <li> tag with the attribute @attribute_name that @c is inside of, or nullptr if there is none
+    static const char* find_enclosing_li_with_attribute(const char *begin, const char *end, const char *c, const char *attribute_name) {
+        std::string value;
+        int depth = 0;
+        for(const char *tag_begin = find_tag_begin_reverse(begin, c); tag_begin; tag_begin = find_tag_begin_reverse(begin, tag_begin)) {
+            if(is_tag(tag_begin, end, "</li")) {
+                ++depth;
+            } else if(is_tag(tag_begin, end, "<li")) {
+                if(depth > 0) {
+                    --depth;
+                    continue;
+                }
+                const char *tag_end = find_tag_end(tag_begin, end);
+                if(tag_end && tag_get_attribute_value(tag_begin, tag_end, attribute_name, value))
+                    return tag_begin;
+            }
+        }
+        return nullptr;
+    }
+
+    bool youtube_scan_related_media(const std::string &website_data, bool is_playlist, BodyItems &result_items) {
+        const char *begin = website_data.data();
+        const char *end = begin + website_data.size();
+        const char *c;
+        std::string value;
+
+        if(is_playlist) {
+            // Each playlist video is a <li> with the thumbnail, which has the link to the video in it
+            const char *item_li = nullptr;
+            for(c = find(begin, end, "playlist-video"); c; c = find(c, end, "playlist-video")) {
+                const char *a_begin = find_tag_begin_reverse(begin, c);
+                c += 14;
+                if(!a_begin || !is_tag(a_begin, end, "<a"))
+                    continue;
+                const char *a_end = find_tag_end(a_begin, end);
+                if(!a_end)
+                    break;
+                c = a_end;
+
+                if(!tag_get_attribute_value(a_begin, a_end, "class", value) || !class_list_contains(value, "playlist-video") || !tag_get_attribute_value(a_begin, a_end, "href", value))
+                    continue;
+
+                const char *li_begin = find_enclosing_li_with_attribute(begin, end, a_begin, "data-thumbnail-url");
+                if(!li_begin)
+                    continue;
+
+                std::string url = "https://www.youtube.com" + youtube_remove_index_from_playlist_url(value);
+                // The last link in the list item is used if there are several, like the html parser does
+                if(li_begin == item_li) {
+                    result_items.back()->url = std::move(url);
+                    continue;
+                }
+
+                auto item = std::make_unique<BodyItem>("");
+                item->url = std::move(url);
+                // TODO: Also add title for related media. This data is in @data-title
+                if(tag_get_attribute_value(li_begin, find_tag_end(li_begin, end), "data-thumbnail-url", value) && contains(value.c_str(), "ytimg.com"))
+                    item->thumbnail_url = std::move(value);
+                result_items.push_back(std::move(item));
+                item_li = li_begin;
+            }
+        }
+
+        // We want non-playlist videos every when there is a playlist, since we want to play non-playlist videos after
+        // playing all playlist videos
+        c = find(begin, end, "class=\"video-list\"");
+        if(c) {
+            for(c = find(c, end, "class=\"content-wrapper\""); c; c = find(c, end, "class=\"content-wrapper\"")) {
+                const char *a_begin = find(c, end, "<a ");
+                if(!a_begin)
+                    break;
+                const char *a_end = find_tag_end(a_begin, end);
+                if(!a_end)
+                    break;
+
+                // TODO: Also add title for related media and thumbnail
+                if(tag_get_attribute_value(a_begin, a_end, "href", value) && begins_with(value.c_str(), "/watch?v=")) {
+                    auto item = std::make_unique<BodyItem>("");
+                    item->url = "https://www.youtube.com" + value;
+                    result_items.push_back(std::move(item));
+                }
+                c = a_end;
+            }
+        }
+
+        return !result_items.empty();
+    }
+
+    int youtube_parse_related_media(const std::string &website_data, bool is_playlist, BodyItems &result_items) {
+        BodyItems non_playlist_items;
+        std::unique_ptr<BodyItem> item;
+        HtmlMultiSearch html_search;
+
+        if(is_playlist) {
+            int playlist_video_query = html_search.add_item_query("//li[data-thumbnail-url]",
+                [&item](const HtmlNode &node) {
+                    item = std::make_unique<BodyItem>("");
+                    // TODO: Also add title for related media. This data is in @data-title
+                    const char *data_thumbnail_url = node.get_attribute_value("data-thumbnail-url");
+                    if(data_thumbnail_url && contains(data_thumbnail_url, "ytimg.com"))
+                        item->thumbnail_url = data_thumbnail_url;
+                },
+                [&item, &result_items]() {
+                    if(item && !item->url.empty())
+                        result_items.push_back(std::move(item));
+                    item.reset();
+                });
+
+            html_search.add_item_child_query(playlist_video_query, "//a[class='playlist-video']",
+                [&item](const HtmlNode &node) {
+                    const char *href = node.get_attribute_value("href");
+                    if(item && href)
+                        item->url = std::string("https://www.youtube.com") + youtube_remove_index_from_playlist_url(href);
+                });
+        }
+
+        // We want non-playlist videos every when there is a playlist, since we want to play non-playlist videos after
+        // playing all playlist videos
+        html_search.add_query("//ul[class='video-list']//div[class='content-wrapper']/a",
+            [&non_playlist_items](const HtmlNode &node) {
+                const char *href = node.get_attribute_value("href");
+                // TODO: Also add title for related media and thumbnail
+                if(href && begins_with(href, "/watch?v=")) {
+                    auto item = std::make_unique<BodyItem>("");
+                    item->url = std::string("https://www.youtube.com") + href;
+                    non_playlist_items.push_back(std::move(item));
+                }
+            });
+
+        int result = html_search.run(website_data.c_str());
+        for(auto &non_playlist_item : non_playlist_items) {
+            result_items.push_back(std::move(non_playlist_item));
+        }
+        return result;
+    }
+}
@@ -0,0 +1,107 @@
+// Checks that the youtube page scan finds the same items as the html parser on the pages in tests/youtube,
+// and prints how long each of them takes. Build and run from the root of the repository:
+// g++ -std=c++17 -O2 tests/youtube_scan.cpp src/plugins/YoutubeScan.cpp src/HtmlMultiSearch.cpp src/StringUtils.cpp $(pkg-config --cflags jsoncpp) -ltidy -o youtube_scan && ./youtube_scan
+
+#include "../plugins/YoutubeScan.hpp"
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <stdio.h>
+
+using namespace QuickMedia;
+
+static const int NUM_ITERATIONS = 200;
+
+static bool file_get_content(const char *filepath, std::string &result) {
+    std::ifstream file(filepath, std::ios::binary);
+    if(!file)
+        return false;
+    std::stringstream ss;
+    ss << file.rdbuf();
+    result = ss.str();
+    return true;
+}
+
+static bool body_items_equal(const char *name, const BodyItems &scan_items, const BodyItems &parse_items) {
+    if(scan_items.empty()) {
+        fprintf(stderr, "%s: the scan didn't find any items\n", name);
+        return false;
+    }
+
+    if(scan_items.size() != parse_items.size()) {
+        fprintf(stderr, "%s: the scan found %zu items, the parser found %zu items\n", name, scan_items.size(), parse_items.size());
+        return false;
+    }
+
+    bool equal = true;
+    for(size_t i = 0; i < scan_items.size(); ++i) {
+        const BodyItem &scan_item = *scan_items[i];
+        const BodyItem &parse_item = *parse_items[i];
+        if(scan_item.url != parse_item.url || scan_item.title != parse_item.title || scan_item.thumbnail_url != parse_item.thumbnail_url) {
+            fprintf(stderr, "%s: item %zu differs:\n  scan:   url: %s, title: %s, thumbnail: %s\n  parser: url: %s, title: %s, thumbnail: %s\n",
+                name, i,
+                scan_item.url.c_str(), scan_item.title.c_str(), scan_item.thumbnail_url.c_str(),
+                parse_item.url.c_str(), parse_item.title.c_str(), parse_item.thumbnail_url.c_str());
+            equal = false;
+        }
+    }
+    return equal;
+}
+
+template <typename Func>
+static double time_per_run_ms(Func &&func) {
+    auto start = std::chrono::steady_clock::now();
+    for(int i = 0; i < NUM_ITERATIONS; ++i) {
+        func();
+    }
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / NUM_ITERATIONS;
+}
+
+static bool check_search_page(const char *filepath) {
+    std::string website_data;
+    if(!file_get_content(filepath, website_data)) {
+        fprintf(stderr, "Failed to read %s\n", filepath);
+        return false;
+    }
+
+    BodyItems scan_items;
+    BodyItems parse_items;
+    youtube_scan_search_results(website_data, scan_items);
+    if(youtube_parse_search_results(website_data, parse_items) != 0)
+        fprintf(stderr, "%s: the parser failed\n", filepath);
+    bool equal = body_items_equal(filepath, scan_items, parse_items);
+
+    double scan_ms = time_per_run_ms([&website_data]() { BodyItems items; youtube_scan_search_results(website_data, items); });
+    double parse_ms = time_per_run_ms([&website_data]() { BodyItems items; youtube_parse_search_results(website_data, items); });
+    printf("%s: %zu items, scan: %.3f ms, parser: %.3f ms\n", filepath, scan_items.size(), scan_ms, parse_ms);
+    return equal;
+}
+
+static bool check_related_media_page(const char *filepath, bool is_playlist) {
+    std::string website_data;
+    if(!file_get_content(filepath, website_data)) {
+        fprintf(stderr, "Failed to read %s\n", filepath);
+        return false;
+    }
+
+    BodyItems scan_items;
+    BodyItems parse_items;
+    youtube_scan_related_media(website_data, is_playlist, scan_items);
+    if(youtube_parse_related_media(website_data, is_playlist, parse_items) != 0)
+        fprintf(stderr, "%s: the parser failed\n", filepath);
+    bool equal = body_items_equal(filepath, scan_items, parse_items);
+
+    double scan_ms = time_per_run_ms([&website_data, is_playlist]() { BodyItems items; youtube_scan_related_media(website_data, is_playlist, items); });
+    double parse_ms = time_per_run_ms([&website_data, is_playlist]() { BodyItems items; youtube_parse_related_media(website_data, is_playlist, items); });
+    printf("%s: %zu items, scan: %.3f ms, parser: %.3f ms\n", filepath, scan_items.size(), scan_ms, parse_ms);
+    return equal;
+}
+
+int main() {
+    bool success = true;
+    success &= check_search_page("tests/youtube/search.html");
+    success &= check_related_media_page("tests/youtube/related.html", false);
+    success &= check_related_media_page("tests/youtube/playlist.html", true);
+    return success ? 0 : 1;
+}